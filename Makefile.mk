@@ -52,6 +52,7 @@ INCLUDE_PATH         += \
 endif
 
 wineasio_dll_C_SRCS   = asio.c \
+			dsp.c \
 			jackbridge.c \
 			main.c \
 			regsvr.c
@@ -101,4 +102,4 @@ build$(M)/$(wineasio_dll_MODULE): $(wineasio_dll_OBJS)
 
 build$(M)/$(wineasio_dll_MODULE).so: $(wineasio_dll_OBJS)
 	$(WINECC) $^ $(wineasio_dll_LDFLAGS) \
-		-lodbc32 -lole32 -luuid -lwinmm -o $@
+		-lodbc32 -lole32 -luuid -lwinmm -lm -lrt -o $@
@@ -24,13 +24,21 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
  */
 
+#define _GNU_SOURCE     /* cpu_set_t and pthread_setaffinity_np() */
+
 #include <stdbool.h>
 #include <stdio.h>
 #include <errno.h>
 #include <limits.h>
+#include <math.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <link.h>
 #include <sys/mman.h>
 #include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <signal.h>
 
 #ifdef DEBUG
 #include "wine/debug.h"
@@ -47,17 +55,26 @@
 #include <wine/unicode.h>
 #endif
 
+#include "dsp.h"
 #include "jackbridge.h"
+#include "metrics.h"
+#include "trace.h"
 
 #ifdef DEBUG
 WINE_DEFAULT_DEBUG_CHANNEL(asio);
 #endif
 
-#define MAX_ENVIRONMENT_SIZE            6
+#define MAX_ENVIRONMENT_SIZE            16
 #define WINEASIO_MAX_NAME_LENGTH        32
 #define WINEASIO_MINIMUM_BUFFERSIZE     16
 #define WINEASIO_MAXIMUM_BUFFERSIZE     8192
 #define WINEASIO_PREFERRED_BUFFERSIZE   1024
+#define WINEASIO_CLOCK_BANDWIDTH        1.0     /* Hz, of the DLL smoothing the JACK cycle times */
+#define WINEASIO_METER_RELEASE          0.3     /* seconds, for the meter peak and RMS to fall by 1/e */
+#define WINEASIO_CACHE_LINE_SIZE        64
+#define WINEASIO_STACK_LOCK_SIZE        (256 * 1024)    /* bytes locked at the top of each callback thread stack */
+#define WINEASIO_HUGE_PAGE_SIZE         (2 * 1024 * 1024)
+#define WINEASIO_RECOVERY_INTERVAL      250     /* ms between attempts to reconnect to a JACK server that went away */
 
 /* ASIO drivers (breaking the COM specification) use the Microsoft variety of
  * thiscall calling convention which gcc is unable to produce.  These macros
@@ -118,18 +135,36 @@ typedef struct BufferInformation
 typedef struct TimeInformation
 {
     LONG      _1[4];
-    double    _2;
+    double    speed;
     w_int64_t timeStamp;
     w_int64_t numSamples;
     double    sampleRate;
     ULONG     flags;
     char      _3[12];
     double    speedForTimeCode;
-    w_int64_t timeStampForTimeCode;
+    w_int64_t samplesForTimeCode;
     ULONG     flagsForTimeCode;
     char      _4[64];
 } TimeInformation;
 
+typedef struct TransportParameters
+{
+    LONG      command;
+    w_int64_t samplePosition;
+    LONG      track;
+    LONG      trackSwitches[16];
+    char      _1[64];
+} TransportParameters;
+
+typedef struct InputMonitor
+{
+    LONG      input;        /* -1 for all inputs */
+    LONG      output;
+    LONG      gain;         /* 0 to 0x7fffffff, 0x20000000 is 0 dB */
+    LONG      state;
+    LONG      pan;          /* 0 is left, 0x7fffffff is right */
+} InputMonitor;
+
 typedef struct Callbacks
 {
     void (WINEASIO_CALLBACK *swapBuffers) (LONG, LONG);
@@ -176,12 +211,60 @@ typedef struct IWineASIO *LPWINEASIO;
 
 typedef struct IOChannel
 {
-    jack_default_audio_sample_t *audio_buffer;
     char                        port_name[WINEASIO_MAX_NAME_LENGTH];
     jack_port_t                 *port;
     bool                        active;
+    bool                        connect_pending;    /* registered since the hardware connections were last made */
+    const char                  **connections;      /* last known, restored after a server restart, see recover_jack_client() */
+    float                       gain;       /* target gain set by the host, read by the RT thread */
+
+    /* level meter, published by the RT thread under meter_sequence once the host asked for it */
+    uint32_t                    meter_sequence;
+    float                       meter_peak;
+    float                       meter_rms;
+    float                       meter_square;   /* smoothed mean square, RT thread only */
 } IOChannel;
 
+/* per-cycle data of an active channel, kept apart from the IOChannel structures
+ * so that the process callback only walks the channels the host activated */
+typedef struct CopyPlanEntry
+{
+    jack_port_t                 *port;
+    char                        *audio_buffer[2];   /* host buffer halves, in the arena */
+    float                       *ring;      /* period adapter ring, NULL when the host runs at the JACK period */
+    int                         channel;
+    int                         silenced;   /* buffer halves cleared while unconnected, RT thread only */
+    float                       gain;       /* gain reached at the end of the last cycle, RT thread only */
+} CopyPlanEntry;
+
+/* ASIO channel gain and meter, see Future() */
+typedef struct ChannelControls
+{
+    LONG                        channel;
+    LONG                        isInput;
+    LONG                        gain;
+    LONG                        meter;
+    char                        future[32];
+} ChannelControls;
+
+/* direct monitoring route of an input, onto an output pair (or a single output for the last one) */
+typedef struct MonitorRoute
+{
+    int                         input;
+    int                         output[2];  /* -1 if not used */
+    float                       gain[2];
+} MonitorRoute;
+
+/* clock and transport state of a JACK cycle, written by update_cycle_clock() */
+typedef struct CycleClock
+{
+    uint32_t                    frames;             /* frames processed since Start() at the start of the cycle */
+    int64_t                     time;               /* DLL filtered system time of the start of the cycle, ns */
+    jack_transport_state_t      transport_state;
+    uint64_t                    transport_position; /* time code position in samples */
+    double                      transport_speed;    /* from the frame deltas, 0 when stopped */
+} CycleClock;
+
 typedef struct IWineASIOImpl
 {
     /* COM stuff */
@@ -197,15 +280,24 @@ typedef struct IWineASIOImpl
     BOOL                        host_buffer_index;
     Callbacks                  *host_callbacks;
     BOOL                        host_can_time_code;
+    BOOL                        host_can_buffer_size_change;    /* the host takes kAsioBufferSizeChange, the halves fit any period */
+    BOOL                        host_output_ready;
     LONG                        host_current_buffersize;
+    LONG                        host_pending_buffersize;        /* accepted by the host, taken over by the next cycle of that size */
     INT                         host_driver_state;
-    w_int64_t                   host_num_samples;
+    uint64_t                    host_sample_position;   /* of the next host buffer, owned by the thread calling the host */
     double                      host_sample_rate;
     TimeInformation             host_time;
     BOOL                        host_time_info_mode;
-    w_int64_t                   host_time_stamp;
+    LONG                        host_input_latency;     /* as last reported, the host is only notified of changes */
+    LONG                        host_output_latency;
     LONG                        host_version;
 
+    /* position and system time (ns) of the current host buffer, for GetSamplePosition() */
+    uint64_t                    host_buffer_position;
+    int64_t                     host_buffer_time;
+    uint32_t                    host_buffer_sequence;
+
     /* WineASIO configuration options */
     int                         wineasio_number_inputs;
     int                         wineasio_number_outputs;
@@ -213,19 +305,132 @@ typedef struct IWineASIOImpl
     BOOL                        wineasio_connect_to_hardware;
     BOOL                        wineasio_fixed_buffersize;
     LONG                        wineasio_preferred_buffersize;
+    BOOL                        wineasio_period_adapter;
+    BOOL                        wineasio_pipelined;
+    BOOL                        wineasio_process_thread;
+    BOOL                        wineasio_lock_all_memory;
+    BOOL                        wineasio_huge_pages;
+    LONG                        wineasio_trace_signal;
+    cpu_set_t                   wineasio_cpu_affinity;      /* empty to leave the callback threads unpinned */
+    LONG                        wineasio_thread_priority;   /* SCHED_FIFO priority, 0 to keep the one from JACK */
+    LONG                        wineasio_input_sample_type;
+    LONG                        wineasio_output_sample_type;
 
     /* JACK stuff */
     jack_client_t               *jack_client;
+    jack_client_t               *jack_retired_client;   /* replaced by the recovery, kept open for host calls still using it */
     char                        jack_client_name[WINEASIO_MAX_NAME_LENGTH];
     int                         jack_num_input_ports;
     int                         jack_num_output_ports;
     const char                  **jack_input_ports;
     const char                  **jack_output_ports;
-
-    /* jack process callback buffers */
-    jack_default_audio_sample_t *callback_audio_buffer;
+    BOOL                        jack_thread_setup;  /* set by the thread init callback until the first cycle */
+    BOOL                        jack_process_thread;    /* jack_process_thread() runs the cycles, not the process callback */
+    BOOL                        jack_active;        /* activated by the first CreateBuffers(), until Release() */
+    HANDLE                      connect_thread;     /* makes the hardware connections of new ports, see connect_thread() */
+    pthread_mutex_t             jack_lock;          /* held while the client or its ports change, by the host and the recovery */
+    int                         jack_recovering;    /* the port connect callback leaves the channels alone while set */
+    int                         jack_cycle_busy;    /* set by the JACK thread while it runs a cycle, see wait_for_cycle_end() */
+    int                         jack_ports_changing;    /* the JACK thread leaves the ports alone while set */
+
+    /* jack process callback buffers, in the sample formats presented to the host */
+    char                        *callback_arena;        /* host buffer halves and adapter rings of the active channels */
+    size_t                      callback_arena_size;
+    int                         callback_input_sample_size;
+    int                         callback_output_sample_size;
+    dsp_from_float_func         callback_input_convert;
+    dsp_to_float_func           callback_output_convert;
+    dsp_mix_func                callback_mix;
+    dsp_gain_func               callback_gain;
+    dsp_meter_func              callback_meter;
+    float                       *callback_scratch;  /* one period of float audio for gain ramps of inputs */
     IOChannel                   *input_channel;
     IOChannel                   *output_channel;
+    size_t                      input_channel_size; /* of the allocation starting at input_channel */
+
+    /* copy plan built by CreateBuffers(), host_active_inputs/outputs entries long */
+    CopyPlanEntry               *input_plan;
+    CopyPlanEntry               *output_plan;
+
+    /* metering starts with the first meter request of the host, the release factor is per JACK period */
+    int                         meter_enabled;
+    float                       meter_release;
+    jack_nframes_t              meter_frames;
+
+    /* shared memory metrics (see metrics.h), NULL if the segment could not be created */
+    WineASIOMetrics             *metrics;
+    char                        metrics_name[96];
+
+    /* flight recorder, writers claim an event with trace_write, see record_trace() */
+    WineASIOTraceEvent          *trace_events;
+    uint32_t                    trace_write;
+    char                        trace_path[MAX_PATH];
+    struct sigaction            trace_old_action;
+
+    /* one bit per channel, set while its JACK port has connections (see jack_port_connect_callback) */
+    uint32_t                    *input_connected;
+    uint32_t                    *output_connected;
+
+    /* period adapter, used when the host buffer size differs from the JACK period
+     * one ring per active channel, the cursors are free running frame counters
+     * written by the JACK thread, adapter_ring_size is 0 when the adapter is not used */
+    float                       *adapter_buffer;
+    uint32_t                    adapter_ring_size;
+    uint32_t                    adapter_prefill;
+    int32_t                     adapter_reprime;    /* prefill change from a new JACK period, applied by the JACK thread */
+    uint32_t                    adapter_input_write;
+    uint32_t                    adapter_input_read;
+    uint32_t                    adapter_output_write;
+    uint32_t                    adapter_output_read;
+
+    /* recovery from a server shutdown, the shutdown callback wakes the recovery thread */
+    HANDLE                      recovery_thread;
+    sem_t                       recovery_semaphore;
+    int                         recovery_quit;
+    int                         recovery_status;    /* the jack_status_t of the last shutdown, logged by the recovery thread */
+
+    /* pipelined mode, the host runs on its own thread from the adapter rings, woken by the process callback */
+    HANDLE                      pipeline_thread;
+    DWORD                       pipeline_thread_id;
+    sem_t                       pipeline_semaphore;
+    int                         pipeline_quit;
+    HANDLE                      pipeline_output_event;      /* set when OutputReady() committed the outputs */
+    DWORD                       pipeline_output_timeout;    /* ms to wait for OutputReady() */
+    int                         pipeline_output_pending;    /* outputs of the current host cycle not yet committed */
+    BOOL                        pipeline_output_index;
+
+    /* cycle clock, a DLL filtering the JACK cycle start times, in ns in the timeGetTime() time base,
+     * clock_cycle is the snapshot of the current cycle taken once by the process callback,
+     * other threads read it through clock_sequence */
+    int64_t                     clock_offset;
+    jack_nframes_t              clock_period;
+    double                      clock_t0;
+    double                      clock_t1;
+    double                      clock_e2;
+    double                      clock_b;
+    double                      clock_c;
+    uint32_t                    clock_next_frames;
+    jack_nframes_t              clock_transport_frame;
+    BOOL                        clock_transport_rolling;
+    CycleClock                  clock_cycle;
+    uint32_t                    clock_sequence;
+
+    /* direct input monitoring, Future(3) writes one route per input under monitor_sequence,
+     * the process callback copies the enabled ones into monitor_plan when the sequence changed,
+     * monitor_clear lists the outputs the host does not write, which are cleared before mixing */
+    MonitorRoute                *monitor_routes;
+    MonitorRoute                *monitor_plan;
+    MonitorRoute                *monitor_scratch;
+    int                         *monitor_clear;
+    int                         monitor_count;
+    int                         monitor_clear_count;
+    uint32_t                    monitor_sequence;
+    uint32_t                    monitor_plan_sequence;
+
+    /* slow-sync preroll, the JACK transport waits until the host had a buffer at the new position */
+    jack_nframes_t              transport_sync_frame;
+    uint64_t                    transport_sync_buffer;
+    BOOL                        transport_sync_pending;
 } IWineASIOImpl;
 
 enum { Loaded, Initialized, Prepared, Running };
@@ -296,7 +501,14 @@ HIDDEN void __thiscall_OutputReady(void);
 static inline int  jack_buffer_size_callback (jack_nframes_t nframes, void *arg);
 static inline void jack_latency_callback(jack_latency_callback_mode_t mode, void *arg);
 static inline int  jack_process_callback (jack_nframes_t nframes, void *arg);
+static void        *jack_process_thread (void *arg);
 static inline int  jack_sample_rate_callback (jack_nframes_t nframes, void *arg);
+static void        jack_port_connect_callback (jack_port_id_t port_a, jack_port_id_t port_b, int connect, void *arg);
+static int         jack_sync_callback (jack_transport_state_t state, jack_position_t *pos, void *arg);
+static int         jack_xrun_callback (void *arg);
+static void        jack_thread_init_callback (void *arg);
+static void        jack_shutdown_callback (jack_status_t code, const char *reason, void *arg);
+static VOID        set_input_monitor(IWineASIOImpl *This, const InputMonitor *monitor);
 
 /*
  *  Support functions
@@ -304,6 +516,78 @@ static inline int  jack_sample_rate_callback (jack_nframes_t nframes, void *arg)
 
 HRESULT WINAPI  WineASIOCreateInstance(REFIID riid, LPVOID *ppobj);
 static  VOID    configure_driver(IWineASIOImpl *This);
+static  VOID    open_metrics(IWineASIOImpl *This);
+static  VOID    close_metrics(IWineASIOImpl *This);
+static  VOID    open_trace(IWineASIOImpl *This);
+static  VOID    close_trace(IWineASIOImpl *This);
+static  BOOL    dump_trace(IWineASIOImpl *This, const char *path);
+static  VOID    trace_signal_handler(int sig);
+static inline void record_trace(IWineASIOImpl *This, uint16_t type, uint32_t frames, jack_time_t start, jack_time_t end);
+static  VOID    update_port_connected(IWineASIOImpl *This, jack_port_t *port);
+static  BOOL    update_channel_ports(IWineASIOImpl *This);
+static  VOID    unregister_channel_ports(IWineASIOImpl *This);
+static  VOID    wait_for_cycle_end(IWineASIOImpl *This);
+static inline void adapter_commit_outputs(IWineASIOImpl *This, BOOL index);
+static inline uint32_t adapter_prefill_for(const IWineASIOImpl *This, jack_nframes_t jack_period);
+static inline void swap_host_buffers(IWineASIOImpl *This, jack_nframes_t nframes, const CycleClock *clock, int32_t offset);
+static inline uint64_t time_code_position(const jack_position_t *position);
+static VOID     lock_memory(const void *address, size_t size);
+static VOID     unlock_memory(const void *address, size_t size);
+static VOID     lock_driver_code(void);
+static BOOL     arena_create(IWineASIOImpl *This, size_t size);
+static VOID     arena_destroy(IWineASIOImpl *This);
+static VOID     setup_callback_thread(IWineASIOImpl *This);
+static VOID     set_callback_thread_priority(int priority);
+static DWORD WINAPI pipeline_thread(LPVOID arg);
+static VOID     pipeline_join(IWineASIOImpl *This);
+static DWORD WINAPI connect_thread(LPVOID arg);
+static VOID     connect_join(IWineASIOImpl *This);
+static BOOL     set_jack_callbacks(IWineASIOImpl *This, jack_client_t *client);
+static VOID     list_physical_ports(IWineASIOImpl *This);
+static VOID     get_latencies(IWineASIOImpl *This, LONG *input, LONG *output);
+static VOID     notify_latencies(IWineASIOImpl *This);
+static DWORD WINAPI recovery_thread(LPVOID arg);
+
+#define CONNECTED_WORDS(channels)   (((channels) + 31) / 32)
+#define ARENA_ALIGN(size)           (((size) + WINEASIO_CACHE_LINE_SIZE - 1) & ~(size_t) (WINEASIO_CACHE_LINE_SIZE - 1))
+
+/* the driver instance dumped by the trace signal */
+static IWineASIOImpl *trace_instance;
+
+/* set once mlockall() succeeded, which makes locking single allocations pointless */
+static BOOL memory_all_locked;
+
+static inline bool is_port_connected(const uint32_t *bitmap, int channel)
+{
+    return __atomic_load_n(&bitmap[channel / 32], __ATOMIC_ACQUIRE) & (1u << (channel % 32));
+}
+
+/* Sequence locks, for data written by one thread (usually the RT one) and read by others without blocking it
+ * the sequence is odd while an update is in progress, readers retry if it changed while they were reading */
+static inline void seqlock_write_begin(uint32_t *sequence)
+{
+    __atomic_store_n(sequence, *sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void seqlock_write_end(uint32_t *sequence)
+{
+    __atomic_store_n(sequence, *sequence + 1, __ATOMIC_RELEASE);
+}
+
+static inline uint32_t seqlock_read_begin(const uint32_t *sequence)
+{
+    uint32_t    value;
+
+    while ((value = __atomic_load_n(sequence, __ATOMIC_ACQUIRE)) & 1);
+    return value;
+}
+
+static inline bool seqlock_read_retry(const uint32_t *sequence, uint32_t value)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(sequence, __ATOMIC_RELAXED) != value;
+}
 
 static DWORD WINAPI jack_thread_creator_helper(LPVOID arg);
 static int          jack_thread_creator(pthread_t* thread_id, const pthread_attr_t* attr, void *(*function)(void*), void* arg);
@@ -341,13 +625,17 @@ static const IWineASIOVtbl WineASIO_Vtbl =
     (void *) THISCALL(OutputReady)
 };
 
-/* structure needed to create the JACK callback thread in the wine process context */
-struct {
-    void        *(*jack_callback_thread) (void*);
+/* passed from jack_thread_creator() to the new thread on the creator's stack,
+ * which waits on created until the thread copied what it needs */
+typedef struct JackThreadStart
+{
+    void        *(*function) (void*);
     void        *arg;
-    pthread_t   jack_callback_pthread_id;
-    HANDLE      jack_callback_thread_created;
-} jack_thread_creator_privates;
+    int         policy;         /* SCHED_OTHER unless JACK asked for explicit real time scheduling */
+    struct sched_param param;
+    pthread_t   thread_id;
+    HANDLE      created;
+} JackThreadStart;
 
 /*****************************************************************************
  * Interface method definitions
@@ -409,31 +697,49 @@ HIDDEN ULONG STDMETHODCALLTYPE Release(LPWINEASIO iface)
 
     if (This->host_driver_state == Initialized)
     {
+        if (This->recovery_thread)
+        {
+            __atomic_store_n(&This->recovery_quit, 1, __ATOMIC_RELEASE);
+            sem_post(&This->recovery_semaphore);
+            WaitForSingleObject(This->recovery_thread, INFINITE);
+            CloseHandle(This->recovery_thread);
+            This->recovery_thread = NULL;
+        }
+
         /* just for good measure we deinitialize IOChannel structures and unregister JACK ports */
+        connect_join(This);
+        if (This->jack_active)
+            jackbridge_deactivate(This->jack_client);
+        This->jack_active = FALSE;
+        unregister_channel_ports(This);
         for (int i = 0; i < This->wineasio_number_inputs; i++)
-        {
-            jackbridge_port_unregister (This->jack_client, This->input_channel[i].port);
             This->input_channel[i].active = false;
-            This->input_channel[i].port = NULL;
-        }
         for (int i = 0; i < This->wineasio_number_outputs; i++)
-        {
-            jackbridge_port_unregister (This->jack_client, This->output_channel[i].port);
             This->output_channel[i].active = false;
-            This->output_channel[i].port = NULL;
-        }
         This->host_active_inputs = This->host_active_outputs = 0;
         TRACE("%i IOChannel structures released\n", This->wineasio_number_inputs + This->wineasio_number_outputs);
 
         jackbridge_free (This->jack_output_ports);
         jackbridge_free (This->jack_input_ports);
         jackbridge_client_close(This->jack_client);
+        if (This->jack_retired_client)
+            jackbridge_client_close(This->jack_retired_client);
+        sem_destroy(&This->recovery_semaphore);
+        pthread_mutex_destroy(&This->jack_lock);
+        close_metrics(This);
+        close_trace(This);
         if (This->input_channel)
+        {
+            unlock_memory(This->input_channel, This->input_channel_size);
             HeapFree(GetProcessHeap(), 0, This->input_channel);
+        }
     }
     TRACE("WineASIO terminated\n\n");
     if (ref == 0)
+    {
+        unlock_memory(This, sizeof(*This));
         HeapFree(GetProcessHeap(), 0, This);
+    }
     return ref;
 }
 
@@ -454,9 +760,19 @@ HIDDEN LONG STDMETHODCALLTYPE Init(LPWINEASIO iface, void *sysRef)
     int             i;
 
     This->sys_ref = sysRef;
-    mlockall(MCL_FUTURE);
     configure_driver(This);
 
+    /* only what the real time threads touch is locked, unless locking the whole process was asked for */
+    if (This->wineasio_lock_all_memory && !memory_all_locked)
+    {
+        if (!mlockall(MCL_CURRENT | MCL_FUTURE))
+            memory_all_locked = TRUE;
+        else
+            WARN("Unable to lock all memory: %s\n", strerror(errno));
+    }
+    lock_memory(This, sizeof(*This));
+    lock_driver_code();
+
     if (!(This->jack_client = jackbridge_client_open(This->jack_client_name, jack_options, &jack_status)))
     {
         WARN("Unable to open a JACK client as: %s\n", This->jack_client_name);
@@ -467,79 +783,102 @@ HIDDEN LONG STDMETHODCALLTYPE Init(LPWINEASIO iface, void *sysRef)
     This->host_sample_rate = jackbridge_get_sample_rate(This->jack_client);
     This->host_current_buffersize = jackbridge_get_buffer_size(This->jack_client);
 
-    /* Allocate IOChannel structures */
-    This->input_channel = HeapAlloc(GetProcessHeap(), 0, (This->wineasio_number_inputs + This->wineasio_number_outputs) * sizeof(IOChannel));
+    /* Allocate IOChannel structures, followed by the cache line aligned gain scratch buffer and copy plan,
+     * the connection bitmaps and the input monitoring routes */
+    This->input_channel_size = (This->wineasio_number_inputs + This->wineasio_number_outputs)
+        * (sizeof(IOChannel) + sizeof(CopyPlanEntry)) + WINEASIO_CACHE_LINE_SIZE - 1 + WINEASIO_MAXIMUM_BUFFERSIZE * sizeof(float)
+        + (CONNECTED_WORDS(This->wineasio_number_inputs) + CONNECTED_WORDS(This->wineasio_number_outputs)) * sizeof(uint32_t)
+        + 3 * This->wineasio_number_inputs * sizeof(MonitorRoute) + This->wineasio_number_outputs * sizeof(int);
+    This->input_channel = HeapAlloc(GetProcessHeap(), 0, This->input_channel_size);
     if (!This->input_channel)
     {
         jackbridge_client_close(This->jack_client);
         ERR("Unable to allocate IOChannel structures for %i channels\n", This->wineasio_number_inputs);
         return 0;
     }
+    lock_memory(This->input_channel, This->input_channel_size);
     This->output_channel = This->input_channel + This->wineasio_number_inputs;
+    This->callback_scratch = (float *) (((ULONG_PTR) (This->output_channel + This->wineasio_number_outputs)
+        + WINEASIO_CACHE_LINE_SIZE - 1) & ~(ULONG_PTR) (WINEASIO_CACHE_LINE_SIZE - 1));
+    This->input_plan = (CopyPlanEntry *) (This->callback_scratch + WINEASIO_MAXIMUM_BUFFERSIZE);
+    This->output_plan = This->input_plan + This->wineasio_number_inputs;
+    This->input_connected = (uint32_t *) (This->output_plan + This->wineasio_number_outputs);
+    This->output_connected = This->input_connected + CONNECTED_WORDS(This->wineasio_number_inputs);
+    memset(This->input_connected, 0, (CONNECTED_WORDS(This->wineasio_number_inputs) + CONNECTED_WORDS(This->wineasio_number_outputs)) * sizeof(uint32_t));
+    This->monitor_routes = (MonitorRoute *) (This->output_connected + CONNECTED_WORDS(This->wineasio_number_outputs));
+    This->monitor_plan = This->monitor_routes + This->wineasio_number_inputs;
+    This->monitor_scratch = This->monitor_plan + This->wineasio_number_inputs;
+    This->monitor_clear = (int *) (This->monitor_scratch + This->wineasio_number_inputs);
+    for (i = 0; i < This->wineasio_number_inputs; i++)
+    {
+        This->monitor_routes[i].input = i;
+        This->monitor_routes[i].output[0] = This->monitor_routes[i].output[1] = -1;
+    }
+    This->monitor_count = This->monitor_clear_count = 0;
+    This->monitor_sequence = This->monitor_plan_sequence = 0;
+    This->callback_mix = dsp_get_mix();
+    This->callback_gain = dsp_get_gain();
+    This->callback_meter = dsp_get_meter();
+    This->meter_enabled = 0;
+    This->meter_frames = 0;
     TRACE("%i IOChannel structures allocated\n", This->wineasio_number_inputs + This->wineasio_number_outputs);
 
-    /* Get and count physical JACK ports */
-    This->jack_input_ports = jackbridge_get_ports(This->jack_client, NULL, NULL, JackPortIsPhysical | JackPortIsOutput);
-    for (This->jack_num_input_ports = 0; This->jack_input_ports && This->jack_input_ports[This->jack_num_input_ports]; This->jack_num_input_ports++)
-        ;
-    This->jack_output_ports = jackbridge_get_ports(This->jack_client, NULL, NULL, JackPortIsPhysical | JackPortIsInput);
-    for (This->jack_num_output_ports = 0; This->jack_output_ports && This->jack_output_ports[This->jack_num_output_ports]; This->jack_num_output_ports++)
-        ;
+    list_physical_ports(This);
 
-    /* Initialize IOChannel structures */
+    /* Initialize IOChannel structures, the JACK ports are registered by CreateBuffers() for the channels the host activates */
     for (i = 0; i < This->wineasio_number_inputs; i++)
     {
         This->input_channel[i].active = false;
         This->input_channel[i].port = NULL;
+        This->input_channel[i].connect_pending = false;
+        This->input_channel[i].connections = NULL;
+        This->input_channel[i].gain = 1.0f;
+        This->input_channel[i].meter_sequence = 0;
+        This->input_channel[i].meter_peak = This->input_channel[i].meter_rms = This->input_channel[i].meter_square = 0.0f;
         snprintf(This->input_channel[i].port_name, WINEASIO_MAX_NAME_LENGTH, "in_%i", i + 1);
-        This->input_channel[i].port = jackbridge_port_register(This->jack_client,
-            This->input_channel[i].port_name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, i);
         /* TRACE("IOChannel structure initialized for input %d: '%s'\n", i, This->input_channel[i].port_name); */
     }
     for (i = 0; i < This->wineasio_number_outputs; i++)
     {
         This->output_channel[i].active = false;
         This->output_channel[i].port = NULL;
+        This->output_channel[i].connect_pending = false;
+        This->output_channel[i].connections = NULL;
+        This->output_channel[i].gain = 1.0f;
+        This->output_channel[i].meter_sequence = 0;
+        This->output_channel[i].meter_peak = This->output_channel[i].meter_rms = This->output_channel[i].meter_square = 0.0f;
         snprintf(This->output_channel[i].port_name, WINEASIO_MAX_NAME_LENGTH, "out_%i", i + 1);
-        This->output_channel[i].port = jackbridge_port_register(This->jack_client,
-            This->output_channel[i].port_name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, i);
         /* TRACE("IOChannel structure initialized for output %d: '%s'\n", i, This->output_channel[i].port_name); */
     }
     TRACE("%i IOChannel structures initialized\n", This->wineasio_number_inputs + This->wineasio_number_outputs);
 
     jackbridge_set_thread_creator(jack_thread_creator);
 
-    if (!jackbridge_set_buffer_size_callback(This->jack_client, jack_buffer_size_callback, This))
-    {
-        jackbridge_client_close(This->jack_client);
-        HeapFree(GetProcessHeap(), 0, This->input_channel);
-        ERR("Unable to register JACK buffer size change callback\n");
-        return 0;
-    }
-    
-    if (!jackbridge_set_latency_callback(This->jack_client, jack_latency_callback, This))
+    This->jack_thread_setup = FALSE;
+    This->transport_sync_pending = FALSE;
+    open_metrics(This);
+    if (!set_jack_callbacks(This, This->jack_client))
     {
+        jackbridge_free(This->jack_output_ports);
+        jackbridge_free(This->jack_input_ports);
+        This->jack_output_ports = This->jack_input_ports = NULL;
         jackbridge_client_close(This->jack_client);
+        close_metrics(This);
+        unlock_memory(This->input_channel, This->input_channel_size);
         HeapFree(GetProcessHeap(), 0, This->input_channel);
-        ERR("Unable to register JACK latency callback\n");
+        This->input_channel = NULL;
         return 0;
     }
 
-    if (!jackbridge_set_process_callback(This->jack_client, jack_process_callback, This))
-    {
-        jackbridge_client_close(This->jack_client);
-        HeapFree(GetProcessHeap(), 0, This->input_channel);
-        ERR("Unable to register JACK process callback\n");
-        return 0;
-    }
+    /* a server restart or a client kicked out after a timeout is recovered from in the background */
+    pthread_mutex_init(&This->jack_lock, NULL);
+    sem_init(&This->recovery_semaphore, 0, 0);
+    This->recovery_quit = 0;
+    if (!(This->recovery_thread = CreateThread(NULL, 0, recovery_thread, This, 0, NULL)))
+        WARN("Unable to create the recovery thread, a JACK server shutdown will not be recovered from\n");
 
-    if (!jackbridge_set_sample_rate_callback (This->jack_client, jack_sample_rate_callback, This))
-    {
-        jackbridge_client_close(This->jack_client);
-        HeapFree(GetProcessHeap(), 0, This->input_channel);
-        ERR("Unable to register JACK sample rate change callback\n");
-        return 0;
-    }
+    open_trace(This);
+    record_trace(This, WINEASIO_TRACE_INIT, 0, 0, 0);
 
     This->host_driver_state = Initialized;
     TRACE("WineASIO 0.%.1f initialized\n",(float) This->host_version / 10);
@@ -597,52 +936,85 @@ DEFINE_THISCALL_WRAPPER(Start,4)
 HIDDEN LONG STDMETHODCALLTYPE Start(LPWINEASIO iface)
 {
     IWineASIOImpl   *This = (IWineASIOImpl*)iface;
-    int             i;
-    DWORD           time;
+    jack_position_t jack_position;
 
     TRACE("iface: %p\n", iface);
 
     if (This->host_driver_state != Prepared)
         return -1000;
 
-    /* Zero the audio buffer */
-    for (i = 0; i < (This->wineasio_number_inputs + This->wineasio_number_outputs) * 2 * This->host_current_buffersize; i++)
-        This->callback_audio_buffer[i] = 0;
+    if (This->pipeline_thread)
+        pipeline_join(This);
 
-    /* prime the callback by preprocessing one outbound host bufffer */
-    This->host_buffer_index =  0;
-    This->host_num_samples.hi = This->host_num_samples.lo = 0;
+    /* a buffer size change the host accepted while prepared */
+    This->host_current_buffersize = This->host_pending_buffersize;
 
-    time = timeGetTime();
-    This->host_time_stamp.lo = time * 1000000;
-    This->host_time_stamp.hi = ((unsigned long long) time * 1000000) >> 32;
+    /* Zero the audio buffers and adapter rings, which also faults in every page of the arena before the first cycle */
+    memset(This->callback_arena, 0, This->callback_arena_size);
 
-    if (This->host_time_info_mode) /* use the newer swapBuffersWithTimeInfo method if supported */
+    /* empty the period adapter rings, the outputs start out ahead by the prefill */
+    if (This->adapter_ring_size)
     {
-        This->host_time.numSamples.lo = This->host_time.numSamples.hi = 0;
-        This->host_time.timeStamp.lo = This->host_time_stamp.lo;
-        This->host_time.timeStamp.hi = This->host_time_stamp.hi;
-        This->host_time.sampleRate = This->host_sample_rate;
-        This->host_time.flags = 0x7;
+        This->adapter_input_write = This->adapter_input_read = This->adapter_output_read = 0;
+        This->adapter_output_write = This->adapter_prefill;
+        This->adapter_reprime = 0;
+    }
 
-        if (This->host_can_time_code) /* addionally use time code if supported */
+    /* JACK times are in us since an arbitrary point, hosts expect timeGetTime() based ns */
+    This->clock_offset = (int64_t) timeGetTime() * 1000000 - (int64_t) jackbridge_get_time() * 1000;
+    This->clock_period = 0;
+    This->clock_next_frames = 0;
+
+    /* the process callback is not running yet, so the clock is read directly */
+    This->clock_cycle.frames = 0;
+    This->clock_cycle.time = (int64_t) jackbridge_get_time() * 1000 + This->clock_offset;
+    This->clock_cycle.transport_state = jackbridge_transport_query(This->jack_client, &jack_position);
+    This->clock_cycle.transport_position = time_code_position(&jack_position);
+    This->clock_cycle.transport_speed = This->clock_cycle.transport_state == JackTransportRolling ? 1.0 : 0.0;
+    This->clock_transport_frame = jack_position.frame;
+    This->clock_transport_rolling = This->clock_cycle.transport_state == JackTransportRolling;
+
+    if (This->metrics)
+    {
+        __atomic_store_n(&This->metrics->host_buffer_size, This->host_current_buffersize, __ATOMIC_RELAXED);
+        __atomic_store_n(&This->metrics->wakeup_max_usecs, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&This->metrics->swap_max_usecs, 0, __ATOMIC_RELAXED);
+    }
+
+    /* prime the callback by preprocessing one outbound host bufffer */
+    This->host_buffer_index =  0;
+    This->host_sample_position = 0;
+    swap_host_buffers(This, This->host_current_buffersize, &This->clock_cycle, 0);
+
+    /* start the host thread, the process callback wakes it up once running */
+    if (This->wineasio_pipelined)
+    {
+        This->host_output_ready = FALSE;
+        This->pipeline_quit = 0;
+        This->pipeline_output_pending = 0;
+        This->pipeline_output_timeout = 1 + This->host_current_buffersize * 1000 / This->host_sample_rate;
+        This->pipeline_output_event = CreateEventW(NULL, FALSE, FALSE, NULL);
+        if (!This->pipeline_output_event || sem_init(&This->pipeline_semaphore, 0, 0))
         {
-            This->host_time.speedForTimeCode = 1; /* FIXME */
-            This->host_time.timeStampForTimeCode.lo = This->host_time_stamp.lo;
-            This->host_time.timeStampForTimeCode.hi = This->host_time_stamp.hi;
-            This->host_time.flagsForTimeCode = ~(0x3);
+            if (This->pipeline_output_event)
+                CloseHandle(This->pipeline_output_event);
+            This->pipeline_output_event = NULL;
+            ERR("Unable to create the pipeline synchronization objects\n");
+            return -999;
+        }
+        This->pipeline_thread = CreateThread(NULL, 0, pipeline_thread, This, 0, &This->pipeline_thread_id);
+        if (!This->pipeline_thread)
+        {
+            sem_destroy(&This->pipeline_semaphore);
+            CloseHandle(This->pipeline_output_event);
+            This->pipeline_output_event = NULL;
+            ERR("Unable to create the pipeline thread\n");
+            return -999;
         }
-        This->host_callbacks->swapBuffersWithTimeInfo(&This->host_time, This->host_buffer_index, 1);
-    } 
-    else
-    { /* use the old swapBuffers method */
-        This->host_callbacks->swapBuffers(This->host_buffer_index, 1);
     }
 
-    /* switch host buffer */
-    This->host_buffer_index = This->host_buffer_index ? 0 : 1;
-
     This->host_driver_state = Running;
+    record_trace(This, WINEASIO_TRACE_START, This->host_current_buffersize, 0, 0);
     TRACE("WineASIO successfully loaded\n");
     return 0;
 }
@@ -665,6 +1037,17 @@ HIDDEN LONG STDMETHODCALLTYPE Stop(LPWINEASIO iface)
         return -1000;
 
     This->host_driver_state = Prepared;
+    record_trace(This, WINEASIO_TRACE_STOP, 0, 0, 0);
+
+    /* the host must not be called after returning, so wait for the pipeline thread,
+     * unless Stop() is called from bufferSwitch, then it exits on its own and is joined later */
+    if (This->pipeline_thread)
+    {
+        __atomic_store_n(&This->pipeline_quit, 1, __ATOMIC_RELEASE);
+        sem_post(&This->pipeline_semaphore);
+        if (GetCurrentThreadId() != This->pipeline_thread_id)
+            pipeline_join(This);
+    }
 
     return 0;
 }
@@ -700,7 +1083,6 @@ DEFINE_THISCALL_WRAPPER(GetLatencies,12)
 HIDDEN LONG STDMETHODCALLTYPE GetLatencies(LPWINEASIO iface, LONG *inputLatency, LONG *outputLatency)
 {
     IWineASIOImpl           *This = (IWineASIOImpl*)iface;
-    jack_latency_range_t    range;
 
     if (!inputLatency || !outputLatency)
         return -998;
@@ -708,10 +1090,9 @@ HIDDEN LONG STDMETHODCALLTYPE GetLatencies(LPWINEASIO iface, LONG *inputLatency,
     if (This->host_driver_state == Loaded)
         return -1000;
 
-    jackbridge_port_get_latency_range(This->input_channel[0].port, JackCaptureLatency, &range);
-    *inputLatency = range.max;
-    jackbridge_port_get_latency_range(This->output_channel[0].port, JackPlaybackLatency, &range);
-    *outputLatency = range.max;
+    get_latencies(This, inputLatency, outputLatency);
+    This->host_input_latency = *inputLatency;
+    This->host_output_latency = *outputLatency;
     TRACE("iface: %p, input latency: %d, output latency: %d\n", iface, (int)*inputLatency, (int)*outputLatency);
 
     return 0;
@@ -734,11 +1115,22 @@ HIDDEN LONG STDMETHODCALLTYPE GetBufferSize(LPWINEASIO iface, LONG *minSize, LON
     if (!minSize || !maxSize || !preferredSize || !granularity)
         return -998;
 
-    if (This->wineasio_fixed_buffersize)
+    if (This->wineasio_period_adapter)
     {
-        *minSize = *maxSize = *preferredSize = This->host_current_buffersize;
+        *minSize = WINEASIO_MINIMUM_BUFFERSIZE;
+        *maxSize = WINEASIO_MAXIMUM_BUFFERSIZE;
+        *preferredSize = jackbridge_get_buffer_size(This->jack_client);
+        *granularity = 1;
+        TRACE("The period adapter is enabled\nMinimum: %d, maximum: %d, preferred: %d, granularity: %d\n",
+              (int)*minSize, (int)*maxSize, (int)*preferredSize, (int)*granularity);
+        return 0;
+    }
+
+    if (This->wineasio_fixed_buffersize)
+    { /* the JACK period may have changed since Init(), a host asked to reset has to see the new one */
+        *minSize = *maxSize = *preferredSize = jackbridge_get_buffer_size(This->jack_client);
         *granularity = 0;
-        TRACE("Buffersize fixed at %d\n", (int)This->host_current_buffersize);
+        TRACE("Buffersize fixed at %d\n", (int)*preferredSize);
         return 0;
     }
 
@@ -870,16 +1262,28 @@ DEFINE_THISCALL_WRAPPER(GetSamplePosition,12)
 HIDDEN LONG STDMETHODCALLTYPE GetSamplePosition(LPWINEASIO iface, w_int64_t *sPos, w_int64_t *tStamp)
 {
     IWineASIOImpl   *This = (IWineASIOImpl*)iface;
+    uint64_t        position;
+    int64_t         time;
+    uint32_t        sequence;
 
     TRACE("iface: %p, sPos: %p, tStamp: %p\n", iface, sPos, tStamp);
 
     if (!sPos || !tStamp)
         return -998;
 
-    tStamp->lo = This->host_time_stamp.lo;
-    tStamp->hi = This->host_time_stamp.hi;
-    sPos->lo = This->host_num_samples.lo;
-    sPos->hi = 0; /* FIXME */
+    /* consistent snapshot of the buffer the host is processing, without blocking the callback */
+    do
+    {
+        sequence = seqlock_read_begin(&This->host_buffer_sequence);
+        position = __atomic_load_n(&This->host_buffer_position, __ATOMIC_RELAXED);
+        time = __atomic_load_n(&This->host_buffer_time, __ATOMIC_RELAXED);
+    }
+    while (seqlock_read_retry(&This->host_buffer_sequence, sequence));
+
+    tStamp->lo = (ULONG) time;
+    tStamp->hi = (ULONG) (time >> 32);
+    sPos->lo = (ULONG) position;
+    sPos->hi = (ULONG) (position >> 32);
 
     return 0;
 }
@@ -906,7 +1310,7 @@ HIDDEN LONG STDMETHODCALLTYPE GetChannelInfo(LPWINEASIO iface, void *info)
 
     *linfo++ = (isInputType ? This->input_channel : This->output_channel)[channelNumber].active;
     *linfo++ = 0;
-    *linfo++ = 19;
+    *linfo++ = isInputType ? This->wineasio_input_sample_type : This->wineasio_output_sample_type;
     memcpy(linfo, (isInputType ? This->input_channel : This->output_channel)[channelNumber].port_name, WINEASIO_MAX_NAME_LENGTH);
 
     return 0;
@@ -929,6 +1333,12 @@ HIDDEN LONG STDMETHODCALLTYPE CreateBuffers(LPWINEASIO iface, BufferInformation
 {
     IWineASIOImpl   *This = (IWineASIOImpl*)iface;
     BufferInformation  *bufferInfoPerChannel = bufferInfo;
+    CopyPlanEntry   *entry;
+    char            *arena;
+    size_t          input_half_size, output_half_size;
+    jack_nframes_t  jack_period;
+    LONG            ring_size, frames;
+    BOOL            ports_updated;
     int             i, j, k;
 
     TRACE("iface: %p, bufferInfo: %p, numChannels: %d, bufferSize: %d, callbacks: %p\n", iface, bufferInfo, (int)numChannels, (int)bufferSize, callbacks);
@@ -944,7 +1354,8 @@ HIDDEN LONG STDMETHODCALLTYPE CreateBuffers(LPWINEASIO iface, BufferInformation
     {
         if (bufferInfoPerChannel->isInputType)
         {
-            if (j++ >= This->wineasio_number_inputs)
+            if (j++ >= This->wineasio_number_inputs || bufferInfoPerChannel->channelNumber < 0
+                    || bufferInfoPerChannel->channelNumber >= This->wineasio_number_inputs)
             {
                 WARN("Invalid input channel requested\n");
                 return -997;
@@ -952,7 +1363,8 @@ HIDDEN LONG STDMETHODCALLTYPE CreateBuffers(LPWINEASIO iface, BufferInformation
         }
         else
         {
-            if (k++  >= This->wineasio_number_outputs)
+            if (k++  >= This->wineasio_number_outputs || bufferInfoPerChannel->channelNumber < 0
+                    || bufferInfoPerChannel->channelNumber >= This->wineasio_number_outputs)
             {
                 WARN("Invalid output channel requested\n");
                 return -997;
@@ -961,8 +1373,19 @@ HIDDEN LONG STDMETHODCALLTYPE CreateBuffers(LPWINEASIO iface, BufferInformation
     }
 
     /* set buf_size */
-    if (This->wineasio_fixed_buffersize)
+    if (This->wineasio_period_adapter)
+    { /* any size in range, the JACK period is left alone */
+        if (bufferSize < WINEASIO_MINIMUM_BUFFERSIZE || bufferSize > WINEASIO_MAXIMUM_BUFFERSIZE)
+        {
+            WARN("Invalid buffersize %d requested\n", (int)bufferSize);
+            return -997;
+        }
+        This->host_current_buffersize = bufferSize;
+        TRACE("Buffer size set to %d, JACK period is %d\n", (int)bufferSize, (int)jackbridge_get_buffer_size(This->jack_client));
+    }
+    else if (This->wineasio_fixed_buffersize)
     {
+        This->host_current_buffersize = jackbridge_get_buffer_size(This->jack_client);
         if (This->host_current_buffersize != bufferSize)
             return -997;
         TRACE("Buffersize fixed at %d\n", (int)This->host_current_buffersize);
@@ -997,6 +1420,8 @@ HIDDEN LONG STDMETHODCALLTYPE CreateBuffers(LPWINEASIO iface, BufferInformation
 
     This->host_callbacks = callbacks;
     This->host_time_info_mode = This->host_can_time_code = FALSE;
+    This->host_can_buffer_size_change = This->host_callbacks->sendNotification(1, 4, 0, 0) != 0;
+    This->host_pending_buffersize = This->host_current_buffersize;
 
     if (This->host_callbacks->sendNotification(7, 0, 0, 0))
     {
@@ -1005,71 +1430,179 @@ HIDDEN LONG STDMETHODCALLTYPE CreateBuffers(LPWINEASIO iface, BufferInformation
             This->host_can_time_code = TRUE;
     }
 
-    /* Allocate audio buffers */
+    /* the sample format of each direction */
+    This->callback_input_sample_size = dsp_sample_size(This->wineasio_input_sample_type);
+    This->callback_output_sample_size = dsp_sample_size(This->wineasio_output_sample_type);
+    This->callback_input_convert = dsp_get_from_float(This->wineasio_input_sample_type);
+    This->callback_output_convert = dsp_get_to_float(This->wineasio_output_sample_type);
 
-    This->callback_audio_buffer = HeapAlloc(GetProcessHeap(), 0,
-        (This->wineasio_number_inputs + This->wineasio_number_outputs) * 2 * This->host_current_buffersize * sizeof(jack_default_audio_sample_t));
-    if (!This->callback_audio_buffer)
+    /* the recovery thread replaces the client and its ports under the same lock */
+    pthread_mutex_lock(&This->jack_lock);
+
+    /* mark the channels the host activates */
+    for (i = 0; i < This->wineasio_number_inputs; i++) {
+        This->input_channel[i].active = false;
+    }
+    for (i = 0; i < This->wineasio_number_outputs; i++) {
+        This->output_channel[i].active = false;
+    }
+    for (i = 0, bufferInfoPerChannel = bufferInfo; i < numChannels; i++, bufferInfoPerChannel++)
+        (bufferInfoPerChannel->isInputType ? This->input_channel : This->output_channel)[bufferInfoPerChannel->channelNumber].active = true;
+
+    /* the client may still be active from the previous buffers, its cycles keep away from the ports meanwhile,
+     * and so does the connection thread still working on the previous ones */
+    connect_join(This);
+    __atomic_store_n(&This->jack_ports_changing, 1, __ATOMIC_RELAXED);
+    wait_for_cycle_end(This);
+    ports_updated = update_channel_ports(This);
+    __atomic_store_n(&This->jack_ports_changing, 0, __ATOMIC_RELEASE);
+    if (!ports_updated)
     {
-        ERR("Unable to allocate %i audio buffers\n", This->wineasio_number_inputs + This->wineasio_number_outputs);
-        return -994;
+        pthread_mutex_unlock(&This->jack_lock);
+        return -1000;
     }
-    TRACE("%i audio buffers allocated (%i kB)\n", This->wineasio_number_inputs + This->wineasio_number_outputs,
-          (int) ((This->wineasio_number_inputs + This->wineasio_number_outputs) * 2 * This->host_current_buffersize * sizeof(jack_default_audio_sample_t) / 1024));
+
+    /* build the copy plan in channel order, so the process callback only visits active channels */
+    This->host_active_inputs = This->host_active_outputs = 0;
 
     for (i = 0; i < This->wineasio_number_inputs; i++)
-        This->input_channel[i].audio_buffer = This->callback_audio_buffer + (i * 2 * This->host_current_buffersize);
+    {
+        if (!This->input_channel[i].active)
+            continue;
+        This->input_plan[This->host_active_inputs].port = This->input_channel[i].port;
+        This->input_plan[This->host_active_inputs].ring = NULL;
+        This->input_plan[This->host_active_inputs].channel = i;
+        This->input_plan[This->host_active_inputs].silenced = 0;
+        __atomic_load(&This->input_channel[i].gain, &This->input_plan[This->host_active_inputs].gain, __ATOMIC_RELAXED);
+        This->host_active_inputs++;
+    }
     for (i = 0; i < This->wineasio_number_outputs; i++)
-        This->output_channel[i].audio_buffer = This->callback_audio_buffer + ((This->wineasio_number_inputs + i) * 2 * This->host_current_buffersize);
+    {
+        if (!This->output_channel[i].active)
+            continue;
+        This->output_plan[This->host_active_outputs].port = This->output_channel[i].port;
+        This->output_plan[This->host_active_outputs].ring = NULL;
+        This->output_plan[This->host_active_outputs].channel = i;
+        This->output_plan[This->host_active_outputs].silenced = 0;
+        __atomic_load(&This->output_channel[i].gain, &This->output_plan[This->host_active_outputs].gain, __ATOMIC_RELAXED);
+        This->host_active_outputs++;
+    }
 
-    /* initialize BufferInformation structures */
-    bufferInfoPerChannel = bufferInfo;
-    This->host_active_inputs = This->host_active_outputs = 0;
+    /* the outputs the monitoring has to clear depend on the active channels, an odd sequence never matches,
+     * the previous plan and clear list may name ports that are gone, so both are dropped until the rebuild */
+    This->monitor_plan_sequence = 1;
+    This->monitor_count = 0;
+    This->monitor_clear_count = 0;
+
+    /* the period adapter only needs its rings when the host buffer size differs from the JACK period,
+     * pipelined mode always runs the host from the rings */
+    This->adapter_ring_size = This->adapter_prefill = 0;
+    ring_size = 0;
+    jack_period = jackbridge_get_buffer_size(This->jack_client);
+    if ((This->wineasio_period_adapter && This->host_current_buffersize != (LONG) jack_period) || This->wineasio_pipelined)
+    {
+        /* room for a full host buffer plus the largest JACK period on both sides of the prefill,
+         * and another JACK period for a pipelined host running late */
+        ring_size = WINEASIO_MINIMUM_BUFFERSIZE;
+        while (ring_size < 2 * This->host_current_buffersize + (This->wineasio_pipelined ? 2 : 1) * WINEASIO_MAXIMUM_BUFFERSIZE)
+            ring_size <<= 1;
+    }
 
-    for (i = 0; i < This->wineasio_number_inputs; i++) {
-        This->input_channel[i].active = false;
+    /* one arena for the active channels only, every host buffer half starts on a cache line of its own
+     * a host taking kAsioBufferSizeChange keeps its buffers across JACK period changes, so without the
+     * adapter rings its halves have room for the largest period */
+    frames = This->host_current_buffersize;
+    if (This->host_can_buffer_size_change && !ring_size)
+        frames = WINEASIO_MAXIMUM_BUFFERSIZE;
+    else
+        This->host_can_buffer_size_change = FALSE;
+    input_half_size = ARENA_ALIGN(frames * This->callback_input_sample_size);
+    output_half_size = ARENA_ALIGN(frames * This->callback_output_sample_size);
+    if (!arena_create(This, 2 * (This->host_active_inputs * input_half_size + This->host_active_outputs * output_half_size)
+                      + (This->host_active_inputs + This->host_active_outputs) * ring_size * sizeof(float)))
+    {
+        ERR("Unable to allocate %i audio buffers\n", (int)(This->host_active_inputs + This->host_active_outputs));
+        This->host_active_inputs = This->host_active_outputs = 0;
+        pthread_mutex_unlock(&This->jack_lock);
+        return -994;
     }
-    for (i = 0; i < This->wineasio_number_outputs; i++) {
-        This->output_channel[i].active = false;
+    TRACE("%i audio buffers allocated (%i kB), sample conversion uses %s\n", (int)(This->host_active_inputs + This->host_active_outputs),
+          (int) (This->callback_arena_size / 1024), dsp_get_isa_name());
+
+    arena = This->callback_arena;
+    for (i = 0; i < This->host_active_inputs; i++, arena += 2 * input_half_size)
+    {
+        This->input_plan[i].audio_buffer[0] = arena;
+        This->input_plan[i].audio_buffer[1] = arena + input_half_size;
+    }
+    for (i = 0; i < This->host_active_outputs; i++, arena += 2 * output_half_size)
+    {
+        This->output_plan[i].audio_buffer[0] = arena;
+        This->output_plan[i].audio_buffer[1] = arena + output_half_size;
     }
 
-    for (i = 0; i < numChannels; i++, bufferInfoPerChannel++)
+    /* initialize BufferInformation structures from the plan entries of their channels */
+    for (i = 0, bufferInfoPerChannel = bufferInfo; i < numChannels; i++, bufferInfoPerChannel++)
     {
         if (bufferInfoPerChannel->isInputType)
-        {
-            bufferInfoPerChannel->audioBufferStart = &This->input_channel[bufferInfoPerChannel->channelNumber].audio_buffer[0];
-            bufferInfoPerChannel->audioBufferEnd = &This->input_channel[bufferInfoPerChannel->channelNumber].audio_buffer[This->host_current_buffersize];
-            This->input_channel[bufferInfoPerChannel->channelNumber].active = true;
-            This->host_active_inputs++;
-            /* TRACE("ASIO audio buffer for channel %i as input %li created\n", i, This->host_active_inputs); */
-        }
+            for (entry = This->input_plan; entry->channel != bufferInfoPerChannel->channelNumber; entry++)
+                ;
         else
-        {
-            bufferInfoPerChannel->audioBufferStart = &This->output_channel[bufferInfoPerChannel->channelNumber].audio_buffer[0];
-            bufferInfoPerChannel->audioBufferEnd = &This->output_channel[bufferInfoPerChannel->channelNumber].audio_buffer[This->host_current_buffersize];
-            This->output_channel[bufferInfoPerChannel->channelNumber].active = true;
-            This->host_active_outputs++;
-            /* TRACE("ASIO audio buffer for channel %i as output %li created\n", i, This->host_active_outputs); */
-        }
+            for (entry = This->output_plan; entry->channel != bufferInfoPerChannel->channelNumber; entry++)
+                ;
+        bufferInfoPerChannel->audioBufferStart = entry->audio_buffer[0];
+        bufferInfoPerChannel->audioBufferEnd = entry->audio_buffer[1];
     }
     TRACE("%d audio channels initialized\n", (int)(This->host_active_inputs + This->host_active_outputs));
 
-    if (!jackbridge_activate(This->jack_client))
-        return -1000;
+    if (ring_size)
+    {
+        This->adapter_buffer = (float *) arena;
+        for (i = 0; i < This->host_active_inputs; i++)
+            This->input_plan[i].ring = This->adapter_buffer + i * ring_size;
+        for (i = 0; i < This->host_active_outputs; i++)
+            This->output_plan[i].ring = This->adapter_buffer + (This->host_active_inputs + i) * ring_size;
+
+        This->adapter_prefill = adapter_prefill_for(This, jack_period);
+        This->adapter_ring_size = ring_size;
+        TRACE("Period adapter enabled%s, host buffer %d, JACK period %d, prefill %d frames\n", This->wineasio_pipelined ? " (pipelined)" : "",
+              (int)This->host_current_buffersize, (int)jack_period, (int)This->adapter_prefill);
+    }
+
+    /* the client stays active across DisposeBuffers() and CreateBuffers(), so a host reset leaves the graph alone */
+    if (!This->jack_active)
+    {
+        if (!jackbridge_activate(This->jack_client))
+        {
+            arena_destroy(This);
+            This->host_active_inputs = This->host_active_outputs = 0;
+            unregister_channel_ports(This);
+            pthread_mutex_unlock(&This->jack_lock);
+            return -1000;
+        }
+        This->jack_active = TRUE;
+    }
 
-    /* connect to the hardware io */
+    /* connect the new ports to the hardware io in the background, the ones kept from the previous buffers keep
+     * their connections. The port connect callback marks each channel connected as its connection is made */
     if (This->wineasio_connect_to_hardware)
     {
-        for (i = 0; i < This->jack_num_input_ports && i < This->wineasio_number_inputs; i++)
-            if (strstr(jackbridge_port_type(jackbridge_port_by_name(This->jack_client, This->jack_input_ports[i])), "audio"))
-                jackbridge_connect(This->jack_client, This->jack_input_ports[i], jackbridge_port_name(This->input_channel[i].port));
-        for (i = 0; i < This->jack_num_output_ports && i < This->wineasio_number_outputs; i++)
-            if (strstr(jackbridge_port_type(jackbridge_port_by_name(This->jack_client, This->jack_output_ports[i])), "audio"))
-                jackbridge_connect(This->jack_client, jackbridge_port_name(This->output_channel[i].port), This->jack_output_ports[i]);
+        This->connect_thread = CreateThread(NULL, 0, connect_thread, This, 0, NULL);
+        if (!This->connect_thread)
+        {
+            WARN("Unable to create the connection thread, connecting to the hardware io now\n");
+            connect_thread(This);
+        }
     }
 
-    /* at this point all the connections are made and the jack process callback is outputting silence */
+    /* at this point the jack process callback is outputting silence */
     This->host_driver_state = Prepared;
+    pthread_mutex_unlock(&This->jack_lock);
+
+    /* the latency through the driver depends on the period adapter prefill, and the graph has to know */
+    jackbridge_recompute_total_latencies(This->jack_client);
+    get_latencies(This, &This->host_input_latency, &This->host_output_latency);
+    record_trace(This, WINEASIO_TRACE_CREATE_BUFFERS, This->host_current_buffersize, 0, 0);
     return 0;
 }
 
@@ -1094,27 +1627,28 @@ HIDDEN LONG STDMETHODCALLTYPE DisposeBuffers(LPWINEASIO iface)
     if (This->host_driver_state != Prepared)
         return -1000;
 
-    if (!jackbridge_deactivate(This->jack_client))
-        return -1000;
+    if (This->pipeline_thread)
+        pipeline_join(This);
+
+    /* the client stays active and outputs silence, but a cycle started before Stop() may still be using the buffers */
+    pthread_mutex_lock(&This->jack_lock);
+    This->host_driver_state = Initialized;
+    wait_for_cycle_end(This);
 
     This->host_callbacks = NULL;
 
     for (i = 0; i < This->wineasio_number_inputs; i++)
-    {
-        This->input_channel[i].audio_buffer = NULL;
         This->input_channel[i].active = false;
-    }
     for (i = 0; i < This->wineasio_number_outputs; i++)
-    {
-        This->output_channel[i].audio_buffer = NULL;
         This->output_channel[i].active = false;
-    }
     This->host_active_inputs = This->host_active_outputs = 0;
 
-    if (This->callback_audio_buffer)
-        HeapFree(GetProcessHeap(), 0, This->callback_audio_buffer);
+    /* the ports stay registered and connected, the next CreateBuffers() unregisters the ones it does not need */
+    arena_destroy(This);
+    This->adapter_ring_size = This->adapter_prefill = 0;
+    pthread_mutex_unlock(&This->jack_lock);
 
-    This->host_driver_state = Initialized;
+    record_trace(This, WINEASIO_TRACE_DISPOSE_BUFFERS, 0, 0, 0);
     return 0;
 }
 
@@ -1149,10 +1683,35 @@ HIDDEN LONG STDMETHODCALLTYPE ControlPanel(LPWINEASIO iface)
  *              0x3f4847a0 on success, do not use 0
  */
 
+/* Full scale reads as 0x7fffffff, ASIO has no RMS meter so WineASIO returns it in the first LONG of future */
+static void read_meter(IOChannel *channel, ChannelControls *controls)
+{
+    uint32_t    sequence;
+    float       peak, rms;
+    LONG        level;
+
+    do
+    {
+        sequence = seqlock_read_begin(&channel->meter_sequence);
+        __atomic_load(&channel->meter_peak, &peak, __ATOMIC_RELAXED);
+        __atomic_load(&channel->meter_rms, &rms, __ATOMIC_RELAXED);
+    }
+    while (seqlock_read_retry(&channel->meter_sequence, sequence));
+
+    controls->meter = peak < 1.0f ? (LONG) (peak * 2147483647.0f) : 0x7fffffff;
+    level = rms < 1.0f ? (LONG) (rms * 2147483647.0f) : 0x7fffffff;
+    memcpy(controls->future, &level, sizeof(level));
+}
+
 DEFINE_THISCALL_WRAPPER(Future,12)
 HIDDEN LONG STDMETHODCALLTYPE Future(LPWINEASIO iface, LONG selector, void *opt)
 {
     IWineASIOImpl           *This = (IWineASIOImpl *) iface;
+    TransportParameters     *transport;
+    InputMonitor            *monitor;
+    ChannelControls         *controls;
+    float                   gain;
+    jack_nframes_t          frame;
 
     TRACE("iface: %p, selector: %d, opt: %p\n", iface, (int)selector, opt);
 
@@ -1167,26 +1726,82 @@ HIDDEN LONG STDMETHODCALLTYPE Future(LPWINEASIO iface, LONG selector, void *opt)
             TRACE("The host disabled TimeCode\n");
             return 0x3f4847a0;
         case 3:
-            TRACE("The driver denied request to set input monitor\n");
-            return -1000;
+            monitor = (InputMonitor *) opt;
+            if (!monitor || This->host_driver_state == Loaded
+                    || monitor->input < -1 || monitor->input >= This->wineasio_number_inputs
+                    || (monitor->state && (monitor->output < 0 || monitor->output >= This->wineasio_number_outputs)))
+                return -998;
+            set_input_monitor(This, monitor);
+            TRACE("The host set input monitor %d to %s, output %d, gain 0x%x, pan 0x%x\n", (int)monitor->input,
+                  monitor->state ? "on" : "off", (int)monitor->output, (unsigned)monitor->gain, (unsigned)monitor->pan);
+            return 0x3f4847a0;
         case 4:
-            TRACE("The driver denied request for Transport control\n");
-            return -998;
+            transport = (TransportParameters *) opt;
+            if (!transport || This->host_driver_state == Loaded)
+                return -998;
+            switch (transport->command)
+            {
+                case 1:
+                    jackbridge_transport_start(This->jack_client);
+                    TRACE("The host started the transport\n");
+                    return 0x3f4847a0;
+                case 2:
+                    jackbridge_transport_stop(This->jack_client);
+                    TRACE("The host stopped the transport\n");
+                    return 0x3f4847a0;
+                case 3:
+                    /* JACK frame positions are 32 bit, a position beyond that cannot be located */
+                    if (transport->samplePosition.hi)
+                        return -998;
+                    frame = transport->samplePosition.lo;
+                    if (!jackbridge_transport_locate(This->jack_client, frame))
+                        return -998;
+                    TRACE("The host located the transport to %u\n", frame);
+                    return 0x3f4847a0;
+                default:
+                    TRACE("The driver denied Transport command %d\n", (int)transport->command);
+                    return -998;
+            }
         case 5:
-            TRACE("The driver denied request to set input gain\n");
-            return -998;
+            controls = (ChannelControls *) opt;
+            if (!controls || This->host_driver_state == Loaded
+                    || controls->channel < 0 || controls->channel >= This->wineasio_number_inputs)
+                return -998;
+            /* 0x20000000 is unity gain, the range goes up to +12 dB */
+            gain = (float) (controls->gain < 0 ? 0 : controls->gain) / 0x20000000;
+            __atomic_store(&This->input_channel[controls->channel].gain, &gain, __ATOMIC_RELAXED);
+            TRACE("The host set the gain of input %d to 0x%x\n", (int)controls->channel, (unsigned)controls->gain);
+            return 0x3f4847a0;
         case 6:
-            TRACE("The driver denied request to get input meter \n");
-            return -998;
+            controls = (ChannelControls *) opt;
+            if (!controls || This->host_driver_state == Loaded
+                    || controls->channel < 0 || controls->channel >= This->wineasio_number_inputs)
+                return -998;
+            if (!__atomic_exchange_n(&This->meter_enabled, 1, __ATOMIC_RELAXED))
+                TRACE("The host enabled metering\n");
+            read_meter(&This->input_channel[controls->channel], controls);
+            return 0x3f4847a0;
         case 7:
-            TRACE("The driver denied request to set output gain\n");
-            return -998;
+            controls = (ChannelControls *) opt;
+            if (!controls || This->host_driver_state == Loaded
+                    || controls->channel < 0 || controls->channel >= This->wineasio_number_outputs)
+                return -998;
+            gain = (float) (controls->gain < 0 ? 0 : controls->gain) / 0x20000000;
+            __atomic_store(&This->output_channel[controls->channel].gain, &gain, __ATOMIC_RELAXED);
+            TRACE("The host set the gain of output %d to 0x%x\n", (int)controls->channel, (unsigned)controls->gain);
+            return 0x3f4847a0;
         case 8:
-            TRACE("The driver denied request to get output meter\n");
-            return -998;
+            controls = (ChannelControls *) opt;
+            if (!controls || This->host_driver_state == Loaded
+                    || controls->channel < 0 || controls->channel >= This->wineasio_number_outputs)
+                return -998;
+            if (!__atomic_exchange_n(&This->meter_enabled, 1, __ATOMIC_RELAXED))
+                TRACE("The host enabled metering\n");
+            read_meter(&This->output_channel[controls->channel], controls);
+            return 0x3f4847a0;
         case 9:
-            TRACE("The driver does not support input monitor\n");
-            return -998;
+            TRACE("The driver supports input monitor\n");
+            return 0x3f4847a0;
         case 10:
             TRACE("The driver supports TimeInfo\n");
             return 0x3f4847a0;
@@ -1194,20 +1809,28 @@ HIDDEN LONG STDMETHODCALLTYPE Future(LPWINEASIO iface, LONG selector, void *opt)
             TRACE("The driver supports TimeCode\n");
             return 0x3f4847a0;
         case 12:
-            TRACE("The driver denied request for Transport\n");
-            return -998;
+            TRACE("The driver supports Transport\n");
+            return 0x3f4847a0;
         case 13:
-            TRACE("The driver does not support input gain\n");
-            return -998;
+            TRACE("The driver supports input gain\n");
+            return 0x3f4847a0;
         case 14:
-            TRACE("The driver does not support input meter\n");
-            return -998;
+            TRACE("The driver supports input meter\n");
+            return 0x3f4847a0;
         case 15:
-            TRACE("The driver does not support output gain\n");
-            return -998;
+            TRACE("The driver supports output gain\n");
+            return 0x3f4847a0;
         case 16:
-            TRACE("The driver does not support output meter\n");
-            return -998;
+            TRACE("The driver supports output meter\n");
+            return 0x3f4847a0;
+        case WINEASIO_FUTURE_DUMP_TRACE:
+            if (!dump_trace(This, opt ? (const char *) opt : This->trace_path))
+            {
+                WARN("Unable to dump the flight recorder to %s\n", opt ? (const char *) opt : This->trace_path);
+                return -999;
+            }
+            TRACE("The host dumped the flight recorder\n");
+            return 0x3f4847a0;
         case 0x23111961:
             TRACE("The driver denied request to set DSD IO format\n");
             return -1000;
@@ -1228,14 +1851,27 @@ HIDDEN LONG STDMETHODCALLTYPE Future(LPWINEASIO iface, LONG selector, void *opt)
  *  Function:   Tells the driver that output bufffers are ready
  *  Returns:    0 if supported
  *              -1000 to disable
+ *  Note:       Only supported in pipelined mode, where the outputs are handed to JACK right away
  */
 
 DEFINE_THISCALL_WRAPPER(OutputReady,4)
 HIDDEN LONG STDMETHODCALLTYPE OutputReady(LPWINEASIO iface)
 {
+    IWineASIOImpl   *This = (IWineASIOImpl*)iface;
+
     /* disabled to stop stand alone NI programs from spamming the console
     TRACE("iface: %p\n", iface); */
-    return -1000;
+    if (!This->wineasio_pipelined || This->host_driver_state != Running)
+        return -1000;
+
+    /* from now on the pipeline thread waits for OutputReady() instead of the end of bufferSwitch */
+    This->host_output_ready = TRUE;
+    if (__atomic_exchange_n(&This->pipeline_output_pending, 0, __ATOMIC_ACQ_REL))
+    {
+        adapter_commit_outputs(This, This->pipeline_output_index);
+        SetEvent(This->pipeline_output_event);
+    }
+    return 0;
 }
 
 /****************************************************************************
@@ -1245,146 +1881,1908 @@ HIDDEN LONG STDMETHODCALLTYPE OutputReady(LPWINEASIO iface)
 static inline int jack_buffer_size_callback(jack_nframes_t nframes, void *arg)
 {
     IWineASIOImpl   *This = (IWineASIOImpl*)arg;
+    uint32_t        prefill;
 
-    if(This->host_driver_state != Running)
+    record_trace(This, WINEASIO_TRACE_BUFFER_SIZE, nframes, 0, 0);
+    if (This->host_driver_state != Prepared && This->host_driver_state != Running)
+        return 0;
+
+    /* the period adapter keeps the host buffer size, a new JACK period only changes the prefill and so the latency,
+     * the JACK thread moves the outputs by the difference before its next cycle */
+    if (This->adapter_ring_size)
+    {
+        prefill = adapter_prefill_for(This, nframes);
+        __atomic_add_fetch(&This->adapter_reprime, (int32_t) (prefill - This->adapter_prefill), __ATOMIC_RELEASE);
+        __atomic_store_n(&This->adapter_prefill, prefill, __ATOMIC_RELAXED);
+        TRACE("Period adapter prefill %d frames for the new JACK period of %d\n", (int)prefill, (int)nframes);
+        notify_latencies(This);
         return 0;
+    }
+
+    /* the process callback is silent until a cycle of the size the host accepted, see switch_buffer_size(),
+     * the host has switched by then since it was told before the size is published */
+    if (This->host_can_buffer_size_change && nframes >= WINEASIO_MINIMUM_BUFFERSIZE && nframes <= WINEASIO_MAXIMUM_BUFFERSIZE)
+    {
+        if (This->host_callbacks->sendNotification(4, nframes, 0, 0))
+        {
+            TRACE("The host switched to the new JACK period of %d\n", (int)nframes);
+            __atomic_store_n(&This->host_pending_buffersize, nframes, __ATOMIC_RELEASE);
+            return 0;
+        }
+        WARN("The host declined the buffer size change to %d, requesting a reset\n", (int)nframes);
+    }
 
     if (This->host_callbacks->sendNotification(1, 3, 0, 0))
         This->host_callbacks->sendNotification(3, 0, 0, 0);
     return 0;
 }
 
+/* Publishes the latency through the driver, from the ports on one side to the ports on the other.
+ * The host runs within the JACK cycle, so that is what the period adapter holds back and nothing otherwise */
 static inline void jack_latency_callback(jack_latency_callback_mode_t mode, void *arg)
 {
-    IWineASIOImpl   *This = (IWineASIOImpl*)arg;
+    IWineASIOImpl           *This = (IWineASIOImpl*)arg;
+    const IOChannel         *from = This->input_channel, *to = This->output_channel;
+    int                     from_count = This->wineasio_number_inputs, to_count = This->wineasio_number_outputs;
+    jack_latency_range_t    range, total;
+    uint32_t                prefill;
+    int                     i;
+
+    if (mode == JackPlaybackLatency)
+    {
+        from = This->output_channel;
+        to = This->input_channel;
+        from_count = This->wineasio_number_outputs;
+        to_count = This->wineasio_number_inputs;
+    }
 
-    if(This->host_driver_state != Running)
-        return;
+    total.min = UINT32_MAX;
+    total.max = 0;
+    for (i = 0; i < from_count; i++)
+    {
+        if (!from[i].port)
+            continue;
+        jackbridge_port_get_latency_range(from[i].port, mode, &range);
+        if (range.min < total.min)
+            total.min = range.min;
+        if (range.max > total.max)
+            total.max = range.max;
+    }
+    if (total.min > total.max)
+        total.min = total.max = 0;
+    prefill = __atomic_load_n(&This->adapter_prefill, __ATOMIC_RELAXED);
+    total.min += prefill;
+    total.max += prefill;
+    for (i = 0; i < to_count; i++)
+        if (to[i].port)
+            jackbridge_port_set_latency_range(to[i].port, mode, &total);
+
+    notify_latencies(This);
+}
 
-    if (This->host_callbacks->sendNotification(1, 6, 0, 0))
-        This->host_callbacks->sendNotification(6, 0, 0, 0);
+/* Records an event in the flight recorder, from any thread without waiting: each writer claims its own
+ * slot, whose sequence is only set once the event is complete. Times of 0 mean now */
+static inline void record_trace(IWineASIOImpl *This, uint16_t type, uint32_t frames, jack_time_t start, jack_time_t end)
+{
+    WineASIOTraceEvent  *event;
+    uint32_t            index;
 
-    return;
+    if (!This->trace_events)
+        return;
+    if (!start)
+        start = end = jackbridge_get_time();
+
+    index = __atomic_fetch_add(&This->trace_write, 1, __ATOMIC_RELAXED);
+    event = &This->trace_events[index & (WINEASIO_TRACE_EVENTS - 1)];
+    __atomic_store_n(&event->sequence, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    event->type = type;
+    event->buffer_index = This->host_buffer_index;
+    event->transport_state = This->clock_cycle.transport_state;
+    event->frames = frames;
+    event->channels = This->host_active_inputs + This->host_active_outputs;
+    event->start_usecs = start;
+    event->end_usecs = end;
+    __atomic_store_n(&event->sequence, index + 1, __ATOMIC_RELEASE);
 }
 
-static inline int jack_process_callback(jack_nframes_t nframes, void *arg)
+/* Metrics of a host callback, on the thread calling the host. The wake-up delay is measured against the
+ * filtered start of the cycle, so it includes the JACK graph before us and, pipelined, the thread switch */
+static inline void update_swap_metrics(IWineASIOImpl *This, int64_t time, jack_time_t start, jack_time_t end)
 {
-    IWineASIOImpl               *This = (IWineASIOImpl*)arg;
-
-    int                         i;
-    jack_transport_state_t      jack_transport_state;
-    jack_position_t             jack_position;
-    DWORD                       time;
+    WineASIOMetrics *metrics = This->metrics;
+    const uint32_t  swap = end - start;
+    const int64_t   wakeup = (int64_t) start * 1000 + This->clock_offset - time;
+    const uint32_t  wakeup_usecs = wakeup > 0 ? wakeup / 1000 : 0;
+    unsigned int    bucket;
+
+    bucket = swap * 8e-6 * This->host_sample_rate / This->host_current_buffersize;
+    if (bucket >= WINEASIO_METRICS_BUCKETS)
+        bucket = WINEASIO_METRICS_BUCKETS - 1;
+
+    __atomic_store_n(&metrics->swaps, metrics->swaps + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&metrics->swap_histogram[bucket], metrics->swap_histogram[bucket] + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&metrics->swap_last_usecs, swap, __ATOMIC_RELAXED);
+    if (swap > metrics->swap_max_usecs)
+        __atomic_store_n(&metrics->swap_max_usecs, swap, __ATOMIC_RELAXED);
+    __atomic_store_n(&metrics->wakeup_last_usecs, wakeup_usecs, __ATOMIC_RELAXED);
+    if (wakeup_usecs > metrics->wakeup_max_usecs)
+        __atomic_store_n(&metrics->wakeup_max_usecs, wakeup_usecs, __ATOMIC_RELAXED);
+}
 
-    /* output silence if the host callback isn't running yet */
-    if (This->host_driver_state != Running)
-    {
-        for (i = 0; i < This->host_active_outputs; i++)
-            memset(jackbridge_port_get_buffer(This->output_channel[i].port, nframes),
-                   0, sizeof (jack_default_audio_sample_t) * nframes);
-        return 0;
-    }
+/* Metrics of a whole JACK process cycle, up to when JACK got the outputs */
+static inline void update_process_metrics(IWineASIOImpl *This, jack_time_t start, jack_time_t end)
+{
+    WineASIOMetrics *metrics = This->metrics;
+    const uint32_t  process = end - start;
+    const float     load = jackbridge_cpu_load(This->jack_client);
+
+    __atomic_store_n(&metrics->cycles, metrics->cycles + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&metrics->process_last_usecs, process, __ATOMIC_RELAXED);
+    if (process > metrics->process_max_usecs)
+        __atomic_store_n(&metrics->process_max_usecs, process, __ATOMIC_RELAXED);
+    __atomic_store(&metrics->dsp_load, &load, __ATOMIC_RELAXED);
+}
 
-    /* copy jack to host buffers */
-    for (i = 0; i < This->wineasio_number_inputs; i++)
-        if (This->input_channel[i].active)
-            memcpy (&This->input_channel[i].audio_buffer[nframes * This->host_buffer_index],
-                    jackbridge_port_get_buffer(This->input_channel[i].port, nframes),
-                    sizeof (jack_default_audio_sample_t) * nframes);
+/* Runs one host cycle on the current half buffer, then switches to the other one
+ * offset is the position of the first sample of the buffer relative to the start of the clock's cycle */
+static inline void swap_host_buffers(IWineASIOImpl *This, jack_nframes_t nframes, const CycleClock *clock, int32_t offset)
+{
+    const int64_t   time = clock->time + (int64_t) (offset * 1e9 / This->host_sample_rate);
+    uint64_t        position;
+    jack_time_t     start, end;
 
-    if (This->host_num_samples.lo > ULONG_MAX - nframes)
-        This->host_num_samples.hi++;
-    This->host_num_samples.lo += nframes;
+    seqlock_write_begin(&This->host_buffer_sequence);
+    __atomic_store_n(&This->host_buffer_position, This->host_sample_position, __ATOMIC_RELAXED);
+    __atomic_store_n(&This->host_buffer_time, time, __ATOMIC_RELAXED);
+    seqlock_write_end(&This->host_buffer_sequence);
 
-    time = timeGetTime();
-    This->host_time_stamp.lo = time * 1000000;
-    This->host_time_stamp.hi = ((unsigned long long) time * 1000000) >> 32;
+    start = jackbridge_get_time();
 
     if (This->host_time_info_mode) /* use the newer swapBuffersWithTimeInfo method if supported */
     {
-        This->host_time.numSamples.lo = This->host_num_samples.lo;
-        This->host_time.numSamples.hi = This->host_num_samples.hi;
-        This->host_time.timeStamp.lo = This->host_time_stamp.lo;
-        This->host_time.timeStamp.hi = This->host_time_stamp.hi;
+        This->host_time.numSamples.lo = (ULONG) This->host_sample_position;
+        This->host_time.numSamples.hi = (ULONG) (This->host_sample_position >> 32);
+        This->host_time.timeStamp.lo = (ULONG) time;
+        This->host_time.timeStamp.hi = (ULONG) (time >> 32);
         This->host_time.sampleRate = This->host_sample_rate;
-        This->host_time.flags = 0x7;
+        This->host_time.speed = 1.0;
+        This->host_time.flags = 0xf; /* system time, sample position, sample rate & speed valid */
 
-        if (This->host_can_time_code) /* FIXME addionally use time code if supported */
+        if (This->host_can_time_code) /* addionally use time code if supported */
         {
-            jack_transport_state = jackbridge_transport_query(This->jack_client, &jack_position);
-            This->host_time.flagsForTimeCode = 0x1;
-            if (jack_transport_state == JackTransportRolling)
-                This->host_time.flagsForTimeCode |= 0x2;
-        }
-        This->host_callbacks->swapBuffersWithTimeInfo(&This->host_time, This->host_buffer_index, 1);
-    }
+            position = clock->transport_position + (int64_t) (offset * clock->transport_speed);
+            This->host_time.speedForTimeCode = clock->transport_speed;
+            This->host_time.samplesForTimeCode.lo = (ULONG) position;
+            This->host_time.samplesForTimeCode.hi = (ULONG) (position >> 32);
+            This->host_time.flagsForTimeCode = 0x101; /* valid, speed valid */
+            if (clock->transport_state == JackTransportRolling)
+            {
+                This->host_time.flagsForTimeCode |= 0x2; /* running */
+                if (clock->transport_speed < 0)
+                    This->host_time.flagsForTimeCode |= 0x4; /* reverse */
+                if (clock->transport_speed > 0.999 && clock->transport_speed < 1.001)
+                    This->host_time.flagsForTimeCode |= 0x8; /* on speed */
+            }
+            else
+            {
+                This->host_time.flagsForTimeCode |= 0x10; /* still */
+            }
+        }
+        This->host_callbacks->swapBuffersWithTimeInfo(&This->host_time, This->host_buffer_index, 1);
+    }
     else
     { /* use the old swapBuffers method */
         This->host_callbacks->swapBuffers(This->host_buffer_index, 1);
     }
 
-    /* copy host to jack buffers */
+    end = jackbridge_get_time();
+    record_trace(This, WINEASIO_TRACE_CYCLE, nframes, start, end);
+    if (This->metrics)
+        update_swap_metrics(This, time, start, end);
+
+    /* switch host buffer */
+    This->host_buffer_index = This->host_buffer_index ? 0 : 1;
+    This->host_sample_position += nframes;
+}
+
+/* Feeds the start time of this JACK cycle to the cycle clock DLL, and publishes the filtered time */
+static inline void update_cycle_clock(IWineASIOImpl *This, jack_nframes_t nframes)
+{
+    jack_nframes_t          current_frames;
+    jack_time_t             current_usecs, next_usecs;
+    float                   period_usecs;
+    double                  time, error, omega, speed;
+    jack_position_t         jack_position;
+    jack_transport_state_t  jack_transport_state;
+    int32_t                 delta;
+
+    if (!jackbridge_get_cycle_times(This->jack_client, &current_frames, &current_usecs, &next_usecs, &period_usecs))
+        current_usecs = jackbridge_frames_to_time(This->jack_client, jackbridge_last_frame_time(This->jack_client));
+    time = current_usecs * 1000.0 + This->clock_offset;
+
+    /* the transport is queried here only, the speed follows from how far it moved during the last cycle
+     * and a jump of more than a period either way is a relocation, not a speed change */
+    jack_transport_state = jackbridge_transport_query(This->jack_client, &jack_position);
+    speed = 0.0;
+    if (jack_transport_state == JackTransportRolling)
+    {
+        speed = 1.0;
+        delta = jack_position.frame - This->clock_transport_frame;
+        if (This->clock_transport_rolling && This->clock_period
+                && delta <= 2 * (int32_t) This->clock_period && delta >= -2 * (int32_t) This->clock_period)
+            speed = (double) delta / This->clock_period;
+    }
+    This->clock_transport_frame = jack_position.frame;
+    This->clock_transport_rolling = jack_transport_state == JackTransportRolling;
+
+    /* (re)start on the first cycle, after a period change, and when cycles were skipped */
+    error = time - This->clock_t1;
+    if (This->clock_period != nframes || error > This->clock_e2 || error < -This->clock_e2)
+    {
+        omega = 2 * 3.14159265358979 * WINEASIO_CLOCK_BANDWIDTH * nframes / This->host_sample_rate;
+        This->clock_b = 1.41421356237310 * omega;
+        This->clock_c = omega * omega;
+        This->clock_e2 = nframes * 1e9 / This->host_sample_rate;
+        This->clock_t0 = time;
+        This->clock_t1 = time + This->clock_e2;
+        This->clock_period = nframes;
+    }
+    else
+    {
+        This->clock_t0 = This->clock_t1;
+        This->clock_t1 += This->clock_b * error + This->clock_e2;
+        This->clock_e2 += This->clock_c * error;
+    }
+
+    seqlock_write_begin(&This->clock_sequence);
+    This->clock_cycle.frames = This->clock_next_frames;
+    This->clock_cycle.time = (int64_t) This->clock_t0;
+    This->clock_cycle.transport_state = jack_transport_state;
+    This->clock_cycle.transport_position = time_code_position(&jack_position);
+    This->clock_cycle.transport_speed = speed;
+    seqlock_write_end(&This->clock_sequence);
+    This->clock_next_frames += nframes;
+}
+
+/* Copies the snapshot of the current cycle, for threads other than the process callback */
+static inline void read_cycle_clock(IWineASIOImpl *This, CycleClock *clock)
+{
+    uint32_t    sequence;
+
+    do
+    {
+        sequence = seqlock_read_begin(&This->clock_sequence);
+        *clock = This->clock_cycle;
+    }
+    while (seqlock_read_retry(&This->clock_sequence, sequence));
+}
+
+/* Time code position in samples, from the SMPTE time if the timebase master provides it */
+static inline uint64_t time_code_position(const jack_position_t *position)
+{
+    if ((position->valid & JackPositionTimecode) && position->frame_time >= 0)
+        return (uint64_t) (position->frame_time * position->frame_rate + 0.5);
+    return position->frame;
+}
+
+/* The output has to be ahead by the largest remainder of a JACK period count divided by the host buffer size,
+ * which is the host buffer size minus their gcd, and a pipelined host has one more JACK period for its outputs */
+static inline uint32_t adapter_prefill_for(const IWineASIOImpl *This, jack_nframes_t jack_period)
+{
+    uint32_t    a = This->host_current_buffersize, b = jack_period, c;
+
+    while (b)
+    {
+        c = a % b;
+        a = b;
+        b = c;
+    }
+    return This->host_current_buffersize - a + (This->wineasio_pipelined ? jack_period : 0);
+}
+
+/* Copy frames between a host buffer and a period adapter ring, converting the sample format */
+static inline void adapter_ring_to_host(IWineASIOImpl *This, char *host_buffer, const float *ring, uint32_t position, jack_nframes_t frames)
+{
+    const uint32_t  index = position & (This->adapter_ring_size - 1);
+    const uint32_t  first = frames < This->adapter_ring_size - index ? frames : This->adapter_ring_size - index;
+
+    This->callback_input_convert(host_buffer, ring + index, first);
+    if (first < frames)
+        This->callback_input_convert(host_buffer + first * This->callback_input_sample_size, ring, frames - first);
+}
+
+static inline void adapter_host_to_ring(IWineASIOImpl *This, float *ring, uint32_t position, const char *host_buffer, jack_nframes_t frames)
+{
+    const uint32_t  index = position & (This->adapter_ring_size - 1);
+    const uint32_t  first = frames < This->adapter_ring_size - index ? frames : This->adapter_ring_size - index;
+
+    This->callback_output_convert(ring + index, host_buffer, first);
+    if (first < frames)
+        This->callback_output_convert(ring, host_buffer + first * This->callback_output_sample_size, frames - first);
+}
+
+/* Copy frames between a JACK port buffer and a period adapter ring, src or dst NULL clears instead */
+static inline void adapter_ring_write(IWineASIOImpl *This, float *ring, uint32_t position, const float *src, jack_nframes_t frames)
+{
+    const uint32_t  index = position & (This->adapter_ring_size - 1);
+    const uint32_t  first = frames < This->adapter_ring_size - index ? frames : This->adapter_ring_size - index;
+
+    if (src)
+    {
+        memcpy(ring + index, src, sizeof (jack_default_audio_sample_t) * first);
+        memcpy(ring, src + first, sizeof (jack_default_audio_sample_t) * (frames - first));
+    }
+    else
+    {
+        memset(ring + index, 0, sizeof (jack_default_audio_sample_t) * first);
+        memset(ring, 0, sizeof (jack_default_audio_sample_t) * (frames - first));
+    }
+}
+
+static inline void adapter_ring_read(IWineASIOImpl *This, float *dst, const float *ring, uint32_t position, jack_nframes_t frames)
+{
+    const uint32_t  index = position & (This->adapter_ring_size - 1);
+    const uint32_t  first = frames < This->adapter_ring_size - index ? frames : This->adapter_ring_size - index;
+
+    memcpy(dst, ring + index, sizeof (jack_default_audio_sample_t) * first);
+    memcpy(dst + first, ring, sizeof (jack_default_audio_sample_t) * (frames - first));
+}
+
+/* Converts the outputs of a finished host cycle into the rings and hands them to the JACK side */
+static inline void adapter_commit_outputs(IWineASIOImpl *This, BOOL index)
+{
+    const jack_nframes_t    frames = This->host_current_buffersize;
+    const uint32_t          output_write = __atomic_load_n(&This->adapter_output_write, __ATOMIC_RELAXED);
+    int                     i;
+
+    for (i = 0; i < This->host_active_outputs; i++)
+        adapter_host_to_ring(This, This->output_plan[i].ring, output_write,
+                             This->output_plan[i].audio_buffer[index], frames);
+    __atomic_store_n(&This->adapter_output_write, output_write + frames, __ATOMIC_RELEASE);
+}
+
+/* In pipelined mode the outputs are committed by OutputReady() if the host calls it,
+ * and by the pipeline thread once bufferSwitch returned otherwise */
+static inline void pipeline_finish_outputs(IWineASIOImpl *This, BOOL index)
+{
+    if (This->host_output_ready && WaitForSingleObject(This->pipeline_output_event, This->pipeline_output_timeout) == WAIT_OBJECT_0)
+        return;
+
+    if (__atomic_exchange_n(&This->pipeline_output_pending, 0, __ATOMIC_ACQ_REL))
+        adapter_commit_outputs(This, index);
+    else /* OutputReady() claimed this cycle and is still converting */
+        WaitForSingleObject(This->pipeline_output_event, INFINITE);
+}
+
+/* Runs as many host cycles as the input rings hold full host buffers for */
+static inline void adapter_run_host(IWineASIOImpl *This)
+{
+    const jack_nframes_t    frames = This->host_current_buffersize;
+    uint32_t                input_read = __atomic_load_n(&This->adapter_input_read, __ATOMIC_RELAXED);
+    int32_t                 late;
+    CycleClock              clock;
+    BOOL                    index;
+    int                     i;
+
+    /* a pipelined host that missed its deadline skips ahead, so the latency stays what GetLatencies() reported */
+    if (This->wineasio_pipelined)
+    {
+        late = __atomic_load_n(&This->adapter_output_read, __ATOMIC_ACQUIRE) - __atomic_load_n(&This->adapter_output_write, __ATOMIC_RELAXED);
+        if (late > 0)
+        {
+            input_read += late;
+            This->host_sample_position += late;
+            __atomic_store_n(&This->adapter_output_write, This->adapter_output_write + late, __ATOMIC_RELAXED);
+        }
+    }
+
+    /* the host may call Stop() from bufferSwitch, it must not be called again after that */
+    while (__atomic_load_n(&This->adapter_input_write, __ATOMIC_ACQUIRE) - input_read >= frames
+           && This->host_driver_state == Running)
+    {
+        index = This->host_buffer_index;
+
+        for (i = 0; i < This->host_active_inputs; i++)
+            adapter_ring_to_host(This, This->input_plan[i].audio_buffer[index], This->input_plan[i].ring, input_read, frames);
+        input_read += frames;
+        __atomic_store_n(&This->adapter_input_read, input_read, __ATOMIC_RELEASE);
+
+        if (This->wineasio_pipelined)
+        {
+            This->pipeline_output_index = index;
+            __atomic_store_n(&This->pipeline_output_pending, 1, __ATOMIC_RELEASE);
+            read_cycle_clock(This, &clock);
+            swap_host_buffers(This, frames, &clock, input_read - frames - clock.frames);
+            pipeline_finish_outputs(This, index);
+        }
+        else
+        {
+            swap_host_buffers(This, frames, &This->clock_cycle, input_read - frames - This->clock_cycle.frames);
+            adapter_commit_outputs(This, index);
+        }
+    }
+}
+
+/* Moves the gain of a plan entry to the target of its channel over one cycle, a gain that stays at unity
+ * returns false so the caller can copy the audio untouched */
+static inline bool next_gain_ramp(CopyPlanEntry *entry, const IOChannel *channel, jack_nframes_t nframes, float *gain, float *step)
+{
+    float target;
+
+    __atomic_load(&channel->gain, &target, __ATOMIC_RELAXED);
+    if (entry->gain == 1.0f && target == 1.0f)
+        return false;
+    *gain = entry->gain;
+    *step = (target - entry->gain) / nframes;
+    entry->gain = target;
+    return true;
+}
+
+/* Recomputes the meter release factor when the JACK period changes, returns false while metering is off */
+static inline bool prepare_meters(IWineASIOImpl *This, jack_nframes_t nframes)
+{
+    if (!__atomic_load_n(&This->meter_enabled, __ATOMIC_RELAXED))
+        return false;
+    if (This->meter_frames != nframes)
+    {
+        This->meter_release = expf(-(float) nframes / (WINEASIO_METER_RELEASE * This->host_sample_rate));
+        This->meter_frames = nframes;
+    }
+    return true;
+}
+
+/* Meters a period of a channel, NULL meaning silence, with src scaled by gain. The peak falls back and the
+ * mean square follows with the release time, so a host polling at GUI rate sees every peak. Silent channels publish nothing */
+static inline void update_meter_scaled(IWineASIOImpl *This, IOChannel *channel, const float *src, float gain, jack_nframes_t nframes)
+{
+    float   peak = 0.0f, sum = 0.0f, falloff, rms;
+
+    if (src)
+    {
+        This->callback_meter(src, nframes, &peak, &sum);
+        peak *= gain;
+        sum *= gain * gain;
+    }
+    else if (channel->meter_peak == 0.0f && channel->meter_square == 0.0f)
+    {
+        return;
+    }
+
+    falloff = channel->meter_peak * This->meter_release;
+    if (peak < falloff)
+        peak = falloff;
+    channel->meter_square += (1.0f - This->meter_release) * (sum / nframes - channel->meter_square);
+
+    /* below -120 dB the meter reads as silence, which also keeps denormals out of the decay */
+    if (peak < 1e-6f)
+        peak = 0.0f;
+    if (channel->meter_square < 1e-12f)
+        channel->meter_square = 0.0f;
+    rms = sqrtf(channel->meter_square);
+
+    seqlock_write_begin(&channel->meter_sequence);
+    __atomic_store(&channel->meter_peak, &peak, __ATOMIC_RELAXED);
+    __atomic_store(&channel->meter_rms, &rms, __ATOMIC_RELAXED);
+    seqlock_write_end(&channel->meter_sequence);
+}
+
+static inline void update_meter(IWineASIOImpl *This, IOChannel *channel, const float *src, jack_nframes_t nframes)
+{
+    update_meter_scaled(This, channel, src, 1.0f, nframes);
+}
+
+/* Process thread mode meters once JACK has the outputs, from the port buffers, which stay valid until the
+ * next cycle. Inputs are scaled by the gain reached at the end of the cycle, so a meter skips gain ramps */
+static inline void meter_cycle(IWineASIOImpl *This, jack_nframes_t nframes)
+{
+    const CopyPlanEntry *entry;
+    int                 i;
+
+    if (This->host_driver_state != Running || !prepare_meters(This, nframes))
+        return;
+
+    for (i = 0; i < This->host_active_inputs; i++)
+    {
+        entry = &This->input_plan[i];
+        if (is_port_connected(This->input_connected, entry->channel))
+            update_meter_scaled(This, &This->input_channel[entry->channel], jackbridge_port_get_buffer(entry->port, nframes),
+                                entry->gain, nframes);
+        else
+            update_meter(This, &This->input_channel[entry->channel], NULL, nframes);
+    }
+    for (i = 0; i < This->host_active_outputs; i++)
+    {
+        entry = &This->output_plan[i];
+        update_meter(This, &This->output_channel[entry->channel], is_port_connected(This->output_connected, entry->channel)
+                     ? jackbridge_port_get_buffer(entry->port, nframes) : NULL, nframes);
+    }
+}
+
+/* Pushes a JACK period of input into the rings, unconnected inputs stop writing once their ring has been cleared completely */
+static inline void adapter_push_inputs(IWineASIOImpl *This, jack_nframes_t nframes)
+{
+    const uint32_t  input_write = __atomic_load_n(&This->adapter_input_write, __ATOMIC_RELAXED);
+    const bool      metering = !This->jack_process_thread && prepare_meters(This, nframes);
+    float           *src, gain, step;
+    int             i;
+
+    for (i = 0; i < This->host_active_inputs; i++)
+    {
+        CopyPlanEntry *entry = &This->input_plan[i];
+
+        if (!is_port_connected(This->input_connected, entry->channel))
+        {
+            if (entry->silenced < (int) This->adapter_ring_size)
+            {
+                adapter_ring_write(This, entry->ring, input_write, NULL, nframes);
+                entry->silenced += nframes;
+            }
+            if (metering)
+                update_meter(This, &This->input_channel[entry->channel], NULL, nframes);
+            continue;
+        }
+        entry->silenced = 0;
+        src = jackbridge_port_get_buffer(entry->port, nframes);
+        if (next_gain_ramp(entry, &This->input_channel[entry->channel], nframes, &gain, &step))
+        {
+            This->callback_gain(This->callback_scratch, src, gain, step, nframes);
+            src = This->callback_scratch;
+        }
+        if (metering)
+            update_meter(This, &This->input_channel[entry->channel], src, nframes);
+        adapter_ring_write(This, entry->ring, input_write, src, nframes);
+    }
+    __atomic_store_n(&This->adapter_input_write, input_write + nframes, __ATOMIC_RELEASE);
+}
+
+/* Pulls a JACK period of output from the rings, or silence if the host has not produced it yet */
+static inline void adapter_pull_outputs(IWineASIOImpl *This, jack_nframes_t nframes)
+{
+    const uint32_t  output_read = __atomic_load_n(&This->adapter_output_read, __ATOMIC_RELAXED);
+    const bool      metering = !This->jack_process_thread && prepare_meters(This, nframes);
+    float           *dst, gain, step;
+    int             i;
+
+    /* the prefill keeps the output rings ahead, an underrun only happens when a new JACK period shrinks it
+     * or when a pipelined host misses its deadline, in which case the read position moves on regardless */
+    if ((int32_t) (__atomic_load_n(&This->adapter_output_write, __ATOMIC_ACQUIRE) - output_read) < (int32_t) nframes)
+    {
+        for (i = 0; i < This->host_active_outputs; i++)
+            memset(jackbridge_port_get_buffer(This->output_plan[i].port, nframes), 0, sizeof (jack_default_audio_sample_t) * nframes);
+        if (This->wineasio_pipelined)
+            __atomic_store_n(&This->adapter_output_read, output_read + nframes, __ATOMIC_RELEASE);
+        return;
+    }
+
+    for (i = 0; i < This->host_active_outputs; i++)
+    {
+        CopyPlanEntry *entry = &This->output_plan[i];
+
+        if (!is_port_connected(This->output_connected, entry->channel))
+        {
+            if (!entry->silenced)
+            {
+                memset(jackbridge_port_get_buffer(entry->port, nframes), 0, sizeof (jack_default_audio_sample_t) * nframes);
+                entry->silenced = 1;
+            }
+            if (metering)
+                update_meter(This, &This->output_channel[entry->channel], NULL, nframes);
+            continue;
+        }
+        entry->silenced = 0;
+        dst = jackbridge_port_get_buffer(entry->port, nframes);
+        adapter_ring_read(This, dst, entry->ring, output_read, nframes);
+        if (next_gain_ramp(entry, &This->output_channel[entry->channel], nframes, &gain, &step))
+            This->callback_gain(dst, dst, gain, step, nframes);
+        if (metering)
+            update_meter(This, &This->output_channel[entry->channel], dst, nframes);
+    }
+    __atomic_store_n(&This->adapter_output_read, output_read + nframes, __ATOMIC_RELEASE);
+}
+
+/* Moves the output read cursor, which only the JACK thread writes, by a change of the prefill, so the outputs
+ * are as far ahead as the new JACK period needs. Frames it moves back over have been played already and are cleared */
+static inline void adapter_reprime_outputs(IWineASIOImpl *This, int32_t frames)
+{
+    const uint32_t  output_read = __atomic_load_n(&This->adapter_output_read, __ATOMIC_RELAXED) - frames;
+    int             i;
+
+    if (frames > 0)
+        for (i = 0; i < This->host_active_outputs; i++)
+            adapter_ring_write(This, This->output_plan[i].ring, output_read, NULL, frames);
+    __atomic_store_n(&This->adapter_output_read, output_read, __ATOMIC_RELEASE);
+}
+
+/* Period adapter: JACK periods go through the rings, the host runs whenever a full host buffer is available,
+ * either right here or on the pipeline thread, which only gets woken up */
+static inline void adapter_process(IWineASIOImpl *This, jack_nframes_t nframes)
+{
+    const int32_t   reprime = __atomic_exchange_n(&This->adapter_reprime, 0, __ATOMIC_ACQUIRE);
+
+    if (reprime)
+        adapter_reprime_outputs(This, reprime);
+
+    if (This->wineasio_pipelined)
+    {
+        adapter_pull_outputs(This, nframes);
+        adapter_push_inputs(This, nframes);
+        sem_post(&This->pipeline_semaphore);
+        return;
+    }
+
+    adapter_push_inputs(This, nframes);
+    adapter_run_host(This);
+    adapter_pull_outputs(This, nframes);
+}
+
+/* Picks up input monitoring changes, a torn copy is dropped and the previous routes stay in use for this cycle */
+static inline void update_input_monitors(IWineASIOImpl *This, jack_nframes_t nframes)
+{
+    const uint32_t  sequence = __atomic_load_n(&This->monitor_sequence, __ATOMIC_ACQUIRE);
+    MonitorRoute    *routes;
+    int             i, j, k, count, output;
+
+    if (sequence == This->monitor_plan_sequence || (sequence & 1))
+        return;
+
+    for (i = count = 0; i < This->wineasio_number_inputs; i++)
+        if (This->monitor_routes[i].output[0] >= 0)
+            This->monitor_scratch[count++] = This->monitor_routes[i];
+    if (seqlock_read_retry(&This->monitor_sequence, sequence))
+        return;
+
+    /* channels the host did not activate have no JACK ports, routes from or to them are dropped */
+    for (i = k = 0; i < count; i++)
+    {
+        if (!This->input_channel[This->monitor_scratch[i].input].port)
+            continue;
+        for (j = 0; j < 2; j++)
+            if (This->monitor_scratch[i].output[j] >= 0 && !This->output_channel[This->monitor_scratch[i].output[j]].port)
+                This->monitor_scratch[i].output[j] = -1;
+        This->monitor_scratch[k++] = This->monitor_scratch[i];
+    }
+    count = k;
+
+    /* outputs cleared for the old routes may not be cleared by the new ones */
+    for (i = 0; i < This->monitor_clear_count; i++)
+        memset(jackbridge_port_get_buffer(This->output_channel[This->monitor_clear[i]].port, nframes),
+               0, sizeof (jack_default_audio_sample_t) * nframes);
+
+    routes = This->monitor_plan;
+    This->monitor_plan = This->monitor_scratch;
+    This->monitor_scratch = routes;
+    This->monitor_count = count;
+    This->monitor_plan_sequence = sequence;
+
+    This->monitor_clear_count = 0;
+    for (i = 0; i < count; i++)
+        for (j = 0; j < 2; j++)
+        {
+            output = This->monitor_plan[i].output[j];
+            if (output < 0 || This->output_channel[output].active)
+                continue;
+            for (k = 0; k < This->monitor_clear_count && This->monitor_clear[k] != output; k++)
+                ;
+            if (k == This->monitor_clear_count)
+                This->monitor_clear[This->monitor_clear_count++] = output;
+        }
+}
+
+/* Direct input monitoring, mixes the JACK inputs into the JACK outputs after the host output has been written */
+static inline void mix_input_monitors(IWineASIOImpl *This, jack_nframes_t nframes)
+{
+    const MonitorRoute  *route;
+    const float         *input;
+    int                 i, j;
+
+    update_input_monitors(This, nframes);
+    if (!This->monitor_count)
+        return;
+
+    for (i = 0; i < This->monitor_clear_count; i++)
+        memset(jackbridge_port_get_buffer(This->output_channel[This->monitor_clear[i]].port, nframes),
+               0, sizeof (jack_default_audio_sample_t) * nframes);
+
+    for (i = 0; i < This->monitor_count; i++)
+    {
+        route = &This->monitor_plan[i];
+        /* unregistered ports keep their connection bit, so the port itself is checked as well */
+        if (!This->input_channel[route->input].port || !is_port_connected(This->input_connected, route->input))
+            continue;
+        input = jackbridge_port_get_buffer(This->input_channel[route->input].port, nframes);
+        for (j = 0; j < 2; j++)
+            if (route->output[j] >= 0 && This->output_channel[route->output[j]].port
+                    && is_port_connected(This->output_connected, route->output[j]))
+                This->callback_mix(jackbridge_port_get_buffer(This->output_channel[route->output[j]].port, nframes),
+                                   input, route->gain[j], nframes);
+    }
+}
+
+/* Locks the pages of an allocation used by the real time threads, which also faults them in,
+ * so the callbacks never wait for the kernel to page them back. Failing only loses that guarantee */
+static VOID lock_memory(const void *address, size_t size)
+{
+    const ULONG_PTR page = sysconf(_SC_PAGESIZE);
+    const ULONG_PTR start = (ULONG_PTR) address & ~(page - 1);
+    const ULONG_PTR end = ((ULONG_PTR) address + size + page - 1) & ~(page - 1);
+
+    if (memory_all_locked || !address || !size)
+        return;
+    if (mlock((void *) start, end - start))
+        WARN("Unable to lock %lu kB of memory: %s, check ulimit -l\n", (unsigned long) ((end - start) / 1024), strerror(errno));
+}
+
+/* Unlocks an allocation before it is freed, only the pages entirely inside it as the others may hold locked neighbours */
+static VOID unlock_memory(const void *address, size_t size)
+{
+    const ULONG_PTR page = sysconf(_SC_PAGESIZE);
+    const ULONG_PTR start = ((ULONG_PTR) address + page - 1) & ~(page - 1);
+    const ULONG_PTR end = ((ULONG_PTR) address + size) & ~(page - 1);
+
+    if (memory_all_locked || !address || end <= start)
+        return;
+    munlock((void *) start, end - start);
+}
+
+/* dl_iterate_phdr() callback, locks the loaded segments of the object holding the address in arg */
+static int lock_object_segments(struct dl_phdr_info *info, size_t size, void *arg)
+{
+    const ULONG_PTR address = (ULONG_PTR) arg;
+    const ElfW(Phdr) *phdr;
+    int             i;
+
+    for (i = 0; i < info->dlpi_phnum; i++)
+    {
+        phdr = &info->dlpi_phdr[i];
+        if (phdr->p_type == PT_LOAD && address >= info->dlpi_addr + phdr->p_vaddr
+                && address < info->dlpi_addr + phdr->p_vaddr + phdr->p_memsz)
+            break;
+    }
+    if (i == info->dlpi_phnum)
+        return 0;
+
+    for (i = 0; i < info->dlpi_phnum; i++)
+        if (info->dlpi_phdr[i].p_type == PT_LOAD)
+            lock_memory((const void *) (info->dlpi_addr + info->dlpi_phdr[i].p_vaddr), info->dlpi_phdr[i].p_memsz);
+    return 1;
+}
+
+/* Locks the code and data of the driver once per process, the DSP kernels included */
+static VOID lock_driver_code(void)
+{
+    static BOOL locked;
+
+    if (locked || memory_all_locked)
+        return;
+    locked = TRUE;
+    dl_iterate_phdr(lock_object_segments, (void *) lock_driver_code);
+}
+
+/* Maps the arena for the buffers of the active channels, locked if possible. With huge pages on, 2 MB pages
+ * are tried first to save TLB misses at high channel counts, then transparent huge pages are asked for */
+static BOOL arena_create(IWineASIOImpl *This, size_t size)
+{
+    const size_t    page = sysconf(_SC_PAGESIZE);
+    void            *arena = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+    if (This->wineasio_huge_pages)
+    {
+        This->callback_arena_size = (size + WINEASIO_HUGE_PAGE_SIZE - 1) & ~(size_t) (WINEASIO_HUGE_PAGE_SIZE - 1);
+        arena = mmap(NULL, This->callback_arena_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (arena == MAP_FAILED)
+            WARN("No huge pages for %lu kB of audio buffers, check /proc/sys/vm/nr_hugepages\n", (unsigned long) (size / 1024));
+    }
+#endif
+    if (arena == MAP_FAILED)
+    {
+        This->callback_arena_size = size ? (size + page - 1) & ~(page - 1) : page;
+        arena = mmap(NULL, This->callback_arena_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (arena == MAP_FAILED)
+        {
+            This->callback_arena = NULL;
+            This->callback_arena_size = 0;
+            return FALSE;
+        }
+#ifdef MADV_HUGEPAGE
+        if (This->wineasio_huge_pages)
+            madvise(arena, This->callback_arena_size, MADV_HUGEPAGE);
+#endif
+    }
+
+    This->callback_arena = arena;
+    lock_memory(arena, This->callback_arena_size);
+    return TRUE;
+}
+
+/* Unmapping also unlocks the arena */
+static VOID arena_destroy(IWineASIOImpl *This)
+{
+    if (This->callback_arena)
+        munmap(This->callback_arena, This->callback_arena_size);
+    This->callback_arena = NULL;
+    This->callback_arena_size = 0;
+    This->adapter_buffer = NULL;
+}
+
+/* Pins the calling thread to the configured CPUs, locks the top of its stack and makes it flush denormals to zero,
+ * so denormals in the host's processing cannot turn into CPU spikes */
+static VOID setup_callback_thread(IWineASIOImpl *This)
+{
+    pthread_attr_t  attr;
+    void            *stack;
+    size_t          stack_size;
+#if defined(__i386__) || defined(__x86_64__)
+    unsigned int    mxcsr;
+#elif defined(__aarch64__)
+    uint64_t        fpcr;
+#endif
+
+    if (CPU_COUNT(&This->wineasio_cpu_affinity)
+            && pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &This->wineasio_cpu_affinity))
+        WARN("Unable to set the CPU affinity of the callback thread\n");
+
+    /* the top of the stack is all a callback is expected to use, the pages go away with the thread */
+    if (!pthread_getattr_np(pthread_self(), &attr))
+    {
+        if (!pthread_attr_getstack(&attr, &stack, &stack_size))
+        {
+            if (stack_size > WINEASIO_STACK_LOCK_SIZE)
+            {
+                stack = (char *) stack + stack_size - WINEASIO_STACK_LOCK_SIZE;
+                stack_size = WINEASIO_STACK_LOCK_SIZE;
+            }
+            lock_memory(stack, stack_size);
+        }
+        pthread_attr_destroy(&attr);
+    }
+
+#if defined(__i386__) || defined(__x86_64__)
+    /* FTZ needs SSE, DAZ is missing from some of the first SSE2 processors but present with SSE3 */
+    if (__builtin_cpu_supports("sse"))
+    {
+        __asm__ __volatile__ ("stmxcsr %0" : "=m" (mxcsr));
+        mxcsr |= 0x8000;
+        if (__builtin_cpu_supports("sse3"))
+            mxcsr |= 0x0040;
+        __asm__ __volatile__ ("ldmxcsr %0" : : "m" (mxcsr));
+    }
+#elif defined(__aarch64__)
+    __asm__ __volatile__ ("mrs %0, fpcr" : "=r" (fpcr));
+    fpcr |= 1 << 24;
+    __asm__ __volatile__ ("msr fpcr, %0" : : "r" (fpcr));
+#endif
+}
+
+/* Switches the calling thread to SCHED_FIFO, clamped to the valid priorities */
+static VOID set_callback_thread_priority(int priority)
+{
+    struct sched_param  param;
+    const int           maximum = sched_get_priority_max(SCHED_FIFO);
+
+    param.sched_priority = priority < 1 ? 1 : priority > maximum ? maximum : priority;
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param))
+        WARN("Unable to set real time priority %d for the callback thread\n", param.sched_priority);
+}
+
+/* Wine thread running the host callbacks in pipelined mode, woken by the JACK process callback */
+static DWORD WINAPI pipeline_thread(LPVOID arg)
+{
+    IWineASIOImpl       *This = (IWineASIOImpl*)arg;
+
+    /* run just below the JACK process thread, on the same CPUs */
+    setup_callback_thread(This);
+    if (This->wineasio_thread_priority > 0)
+        set_callback_thread_priority(This->wineasio_thread_priority - 1);
+    else if (jackbridge_is_realtime(This->jack_client))
+        set_callback_thread_priority(jackbridge_client_real_time_priority(This->jack_client) - 1);
+
+    TRACE("Pipeline thread started\n");
+    for (;;)
+    {
+        while (sem_wait(&This->pipeline_semaphore) && errno == EINTR);
+        if (__atomic_load_n(&This->pipeline_quit, __ATOMIC_ACQUIRE))
+            break;
+        adapter_run_host(This);
+    }
+    TRACE("Pipeline thread stopped\n");
+    return 0;
+}
+
+/* Waits for the pipeline thread to exit after Stop() and releases its resources */
+static VOID pipeline_join(IWineASIOImpl *This)
+{
+    WaitForSingleObject(This->pipeline_thread, INFINITE);
+    CloseHandle(This->pipeline_thread);
+    This->pipeline_thread = NULL;
+    sem_destroy(&This->pipeline_semaphore);
+    CloseHandle(This->pipeline_output_event);
+    This->pipeline_output_event = NULL;
+}
+
+/* Connects the ports registered by the last CreateBuffers() to the physical ports of the same number,
+ * which Init() listed for the audio type only. Runs while the host is already starting */
+static DWORD WINAPI connect_thread(LPVOID arg)
+{
+    IWineASIOImpl   *This = (IWineASIOImpl*)arg;
+    int             i, count = 0;
+
+    for (i = 0; i < This->jack_num_input_ports && i < This->wineasio_number_inputs; i++)
+        if (This->input_channel[i].connect_pending)
+            count += jackbridge_connect(This->jack_client, This->jack_input_ports[i], jackbridge_port_name(This->input_channel[i].port));
+    for (i = 0; i < This->jack_num_output_ports && i < This->wineasio_number_outputs; i++)
+        if (This->output_channel[i].connect_pending)
+            count += jackbridge_connect(This->jack_client, jackbridge_port_name(This->output_channel[i].port), This->jack_output_ports[i]);
+
+    for (i = 0; i < This->wineasio_number_inputs; i++)
+        This->input_channel[i].connect_pending = false;
+    for (i = 0; i < This->wineasio_number_outputs; i++)
+        This->output_channel[i].connect_pending = false;
+    TRACE("%d ports connected to the hardware io\n", count);
+    return 0;
+}
+
+static VOID connect_join(IWineASIOImpl *This)
+{
+    if (!This->connect_thread)
+        return;
+    WaitForSingleObject(This->connect_thread, INFINITE);
+    CloseHandle(This->connect_thread);
+    This->connect_thread = NULL;
+}
+
+/* Sets the callbacks of the JACK client, for Init() and again for the client replacing one the server shut down */
+static BOOL set_jack_callbacks(IWineASIOImpl *This, jack_client_t *client)
+{
+    if (!jackbridge_set_thread_init_callback(client, jack_thread_init_callback, This))
+        WARN("Unable to register JACK thread init callback, the callback thread keeps its CPUs and FPU mode\n");
+
+    if (!jackbridge_set_buffer_size_callback(client, jack_buffer_size_callback, This))
+    {
+        ERR("Unable to register JACK buffer size change callback\n");
+        return FALSE;
+    }
+
+    if (!jackbridge_set_latency_callback(client, jack_latency_callback, This))
+    {
+        ERR("Unable to register JACK latency callback\n");
+        return FALSE;
+    }
+
+    /* in process thread mode the driver runs the JACK cycles itself, the process callback is the fallback */
+    This->jack_process_thread = This->wineasio_process_thread
+        && jackbridge_set_process_thread(client, jack_process_thread, This);
+    if (This->wineasio_process_thread && !This->jack_process_thread)
+        WARN("Unable to set a JACK process thread, using the process callback\n");
+
+    if (!This->jack_process_thread && !jackbridge_set_process_callback(client, jack_process_callback, This))
+    {
+        ERR("Unable to register JACK process callback\n");
+        return FALSE;
+    }
+
+    if (!jackbridge_set_sample_rate_callback (client, jack_sample_rate_callback, This))
+    {
+        ERR("Unable to register JACK sample rate change callback\n");
+        return FALSE;
+    }
+
+    /* without connection notifications every port has to be treated as connected */
+    if (!jackbridge_set_port_connect_callback(client, jack_port_connect_callback, This))
+    {
+        WARN("Unable to register JACK port connect callback, unconnected ports will not be skipped\n");
+        memset(This->input_connected, 0xff, (CONNECTED_WORDS(This->wineasio_number_inputs) + CONNECTED_WORDS(This->wineasio_number_outputs)) * sizeof(uint32_t));
+    }
+
+    /* lets the host preroll when the transport starts, see Future(4) */
+    if (!jackbridge_set_sync_callback(client, jack_sync_callback, This))
+        WARN("Unable to register JACK sync callback\n");
+
+    if (This->metrics && !jackbridge_set_xrun_callback(client, jack_xrun_callback, This))
+        WARN("Unable to register JACK xrun callback\n");
+
+    jackbridge_on_info_shutdown(client, jack_shutdown_callback, This);
+    return TRUE;
+}
+
+/* Gets and counts the physical JACK audio ports, the hardware connections use the same number on both sides */
+static VOID list_physical_ports(IWineASIOImpl *This)
+{
+    This->jack_input_ports = jackbridge_get_ports(This->jack_client, NULL, JACK_DEFAULT_AUDIO_TYPE, JackPortIsPhysical | JackPortIsOutput);
+    for (This->jack_num_input_ports = 0; This->jack_input_ports && This->jack_input_ports[This->jack_num_input_ports]; This->jack_num_input_ports++)
+        ;
+    This->jack_output_ports = jackbridge_get_ports(This->jack_client, NULL, JACK_DEFAULT_AUDIO_TYPE, JackPortIsPhysical | JackPortIsInput);
+    for (This->jack_num_output_ports = 0; This->jack_output_ports && This->jack_output_ports[This->jack_num_output_ports]; This->jack_num_output_ports++)
+        ;
+}
+
+/* The latencies reported to the host, the largest of the active ports of each direction plus one host buffer,
+ * which the ASIO documentation asks to include, and on the output side what the period adapter holds back */
+static VOID get_latencies(IWineASIOImpl *This, LONG *input, LONG *output)
+{
+    jack_latency_range_t    range;
+    jack_nframes_t          capture = 0, playback = 0;
+    int                     i;
+
+    for (i = 0; i < This->wineasio_number_inputs; i++)
+    {
+        if (!This->input_channel[i].active || !This->input_channel[i].port)
+            continue;
+        jackbridge_port_get_latency_range(This->input_channel[i].port, JackCaptureLatency, &range);
+        if (range.max > capture)
+            capture = range.max;
+    }
+    for (i = 0; i < This->wineasio_number_outputs; i++)
+    {
+        if (!This->output_channel[i].active || !This->output_channel[i].port)
+            continue;
+        jackbridge_port_get_latency_range(This->output_channel[i].port, JackPlaybackLatency, &range);
+        if (range.max > playback)
+            playback = range.max;
+    }
+    *input = capture + This->host_current_buffersize;
+    *output = playback + This->host_current_buffersize + __atomic_load_n(&This->adapter_prefill, __ATOMIC_RELAXED);
+}
+
+/* Sends kAsioLatenciesChanged while running, only when GetLatencies() would now report something else */
+static VOID notify_latencies(IWineASIOImpl *This)
+{
+    LONG    input, output;
+
+    if (This->host_driver_state != Running)
+        return;
+
+    get_latencies(This, &input, &output);
+    if (input == This->host_input_latency && output == This->host_output_latency)
+        return;
+    TRACE("Latencies changed to %d in, %d out\n", (int)input, (int)output);
+    This->host_input_latency = input;
+    This->host_output_latency = output;
+    if (This->host_callbacks->sendNotification(1, 6, 0, 0))
+        This->host_callbacks->sendNotification(6, 0, 0, 0);
+}
+
+/* Replaces the client the server shut down with a new one, registers the ports the old one had under the same
+ * names and restores their last known connections in one go. The host is asked to resync, or to reset when the
+ * server came back with another sample rate or period, or the ports could not all be registered again */
+static BOOL recover_jack_client(IWineASIOImpl *This)
+{
+    jack_status_t   jack_status;
+    jack_options_t  jack_options = This->wineasio_autostart_server ? JackNullOption : JackNoStartServer;
+    jack_client_t   *client, *old_client;
+    IOChannel       *channel;
+    const char      **connections;
+    Callbacks       *callbacks;
+    jack_nframes_t  sample_rate;
+    BOOL            ports_registered = TRUE, activated = FALSE;
+    LONG            selector = 5;
+    INT             state;
+    int             i, j;
+
+    if (!(client = jackbridge_client_open(This->jack_client_name, jack_options, &jack_status)))
+        return FALSE;
+
+    /* a client without its callbacks is of no use, it is closed and the recovery thread tries again */
+    if (!set_jack_callbacks(This, client))
+    {
+        jackbridge_client_close(client);
+        return FALSE;
+    }
+
+    pthread_mutex_lock(&This->jack_lock);
+    connect_join(This);
+    __atomic_store_n(&This->jack_recovering, 1, __ATOMIC_RELAXED);
+    old_client = This->jack_client;
+    __atomic_store_n(&This->jack_client, client, __ATOMIC_RELEASE);
+    jackbridge_free(This->jack_output_ports);
+    jackbridge_free(This->jack_input_ports);
+    list_physical_ports(This);
+
+    /* the old ports went with the old client, the channels are contiguous from input_channel */
+    for (i = 0; i < This->wineasio_number_inputs + This->wineasio_number_outputs; i++)
+    {
+        channel = &This->input_channel[i];
+        if (!channel->port)
+            continue;
+        channel->connect_pending = false;
+        channel->port = jackbridge_port_register(client, channel->port_name, JACK_DEFAULT_AUDIO_TYPE,
+                                                 i < This->wineasio_number_inputs ? JackPortIsInput : JackPortIsOutput, 0);
+        if (!channel->port)
+        {
+            WARN("Unable to register JACK port %s again\n", channel->port_name);
+            ports_registered = FALSE;
+        }
+    }
+    for (i = 0; i < This->host_active_inputs; i++)
+    {
+        This->input_plan[i].port = This->input_channel[This->input_plan[i].channel].port;
+        This->input_plan[i].silenced = 0;
+    }
+    for (i = 0; i < This->host_active_outputs; i++)
+    {
+        This->output_plan[i].port = This->output_channel[This->output_plan[i].channel].port;
+        This->output_plan[i].silenced = 0;
+    }
+
+    /* with a port missing the client stays inactive, and CreateBuffers() after the reset registers it */
+    if (This->jack_active)
+    {
+        activated = ports_registered && jackbridge_activate(client);
+        This->jack_active = activated;
+    }
+
+    if (activated)
+    {
+        for (i = 0; i < This->wineasio_number_inputs + This->wineasio_number_outputs; i++)
+        {
+            channel = &This->input_channel[i];
+            connections = __atomic_exchange_n(&channel->connections, NULL, __ATOMIC_ACQ_REL);
+            for (j = 0; channel->port && connections && connections[j]; j++)
+            {
+                if (i < This->wineasio_number_inputs)
+                    jackbridge_connect(client, connections[j], jackbridge_port_name(channel->port));
+                else
+                    jackbridge_connect(client, jackbridge_port_name(channel->port), connections[j]);
+            }
+            jackbridge_free(connections);
+        }
+    }
+
+    /* the connection bits and the remembered connections start over from the graph as it is now */
+    __atomic_store_n(&This->jack_recovering, 0, __ATOMIC_RELEASE);
+    for (i = 0; i < This->wineasio_number_inputs + This->wineasio_number_outputs; i++)
+        update_port_connected(This, This->input_channel[i].port);
+
+    sample_rate = jackbridge_get_sample_rate(client);
+    if (!activated || sample_rate != This->host_sample_rate
+            || (!This->adapter_ring_size && (LONG) jackbridge_get_buffer_size(client) != This->host_current_buffersize))
+        selector = 3;
+    This->host_sample_rate = sample_rate;
+    state = This->host_driver_state;
+    callbacks = This->host_callbacks;
+    pthread_mutex_unlock(&This->jack_lock);
+
+    /* host calls outside of the lock may still hold the old client or its ports, so it is only closed once
+     * the next client replaces this one, or on Release() */
+    if (This->jack_retired_client)
+        jackbridge_client_close(This->jack_retired_client);
+    This->jack_retired_client = old_client;
+    TRACE("Reconnected to JACK as: '%s'\n", jackbridge_get_client_name(client));
+
+    /* outside of the lock, the host may dispose of and create its buffers from the notification */
+    if ((state == Prepared || state == Running) && callbacks->sendNotification(1, selector, 0, 0))
+        callbacks->sendNotification(selector, 0, 0, 0);
+    return TRUE;
+}
+
+/* Waits for the shutdown callback, then tries to reconnect until the server is back */
+static DWORD WINAPI recovery_thread(LPVOID arg)
+{
+    IWineASIOImpl   *This = (IWineASIOImpl*)arg;
+
+    for (;;)
+    {
+        if (sem_wait(&This->recovery_semaphore))
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        /* one recovery for any number of shutdown notifications, Release() sets recovery_quit first */
+        while (!sem_trywait(&This->recovery_semaphore))
+            ;
+        if (__atomic_load_n(&This->recovery_quit, __ATOMIC_ACQUIRE))
+            break;
+
+        WARN("JACK shut the client down (status 0x%x), reconnecting to the server\n",
+             __atomic_load_n(&This->recovery_status, __ATOMIC_RELAXED));
+        while (!__atomic_load_n(&This->recovery_quit, __ATOMIC_ACQUIRE) && !recover_jack_client(This))
+            Sleep(WINEASIO_RECOVERY_INTERVAL);
+    }
+    return 0;
+}
+
+/* Takes over a buffer size the host accepted with kAsioBufferSizeChange, on the first cycle of that size,
+ * so the host buffers never see a period they were not told about */
+static inline BOOL switch_buffer_size(IWineASIOImpl *This, jack_nframes_t nframes)
+{
+    int i;
+
+    if (__atomic_load_n(&This->host_pending_buffersize, __ATOMIC_ACQUIRE) != (LONG) nframes)
+        return FALSE;
+
+    This->host_current_buffersize = nframes;
+
+    /* the host buffer halves of unconnected inputs are only cleared up to the old size */
+    for (i = 0; i < This->host_active_inputs; i++)
+        This->input_plan[i].silenced = 0;
+    if (This->metrics)
+        __atomic_store_n(&This->metrics->host_buffer_size, nframes, __ATOMIC_RELAXED);
+    return TRUE;
+}
+
+/* One JACK cycle: the host callback runs directly, or through the period adapter */
+static inline void process_cycle(IWineASIOImpl *This, jack_nframes_t nframes)
+{
+    float                       *src, *dst, gain, step;
+    bool                        metering;
+    int                         i;
+    BOOL                        index;
+
+    /* output silence if the host callback isn't running yet, or its buffers are not for this period yet */
+    if (This->host_driver_state != Running || nframes > WINEASIO_MAXIMUM_BUFFERSIZE
+            || (!This->adapter_ring_size && (LONG) nframes != This->host_current_buffersize && !switch_buffer_size(This, nframes)))
+    {
+        if (__atomic_load_n(&This->jack_ports_changing, __ATOMIC_RELAXED))
+            return;
+        for (i = 0; i < This->wineasio_number_outputs; i++)
+            if (This->output_channel[i].port)
+                memset(jackbridge_port_get_buffer(This->output_channel[i].port, nframes),
+                       0, sizeof (jack_default_audio_sample_t) * nframes);
+        return;
+    }
+
+    update_cycle_clock(This, nframes);
+
+    if (This->adapter_ring_size)
+    {
+        adapter_process(This, nframes);
+        mix_input_monitors(This, nframes);
+        return;
+    }
+
+    index = This->host_buffer_index;
+    metering = !This->jack_process_thread && prepare_meters(This, nframes);
+
+    /* copy jack to host buffers, unconnected inputs get both host buffer halves cleared once and are skipped after that */
+    for (i = 0; i < This->host_active_inputs; i++)
+    {
+        CopyPlanEntry *entry = &This->input_plan[i];
+        char *host_buffer = entry->audio_buffer[index];
+
+        if (!is_port_connected(This->input_connected, entry->channel))
+        {
+            if (entry->silenced < 2)
+            {
+                memset(host_buffer, 0, nframes * This->callback_input_sample_size);
+                entry->silenced++;
+            }
+            if (metering)
+                update_meter(This, &This->input_channel[entry->channel], NULL, nframes);
+            continue;
+        }
+        entry->silenced = 0;
+        src = jackbridge_port_get_buffer(entry->port, nframes);
+        if (next_gain_ramp(entry, &This->input_channel[entry->channel], nframes, &gain, &step))
+        {
+            This->callback_gain(This->callback_scratch, src, gain, step, nframes);
+            src = This->callback_scratch;
+        }
+        if (metering)
+            update_meter(This, &This->input_channel[entry->channel], src, nframes);
+        This->callback_input_convert(host_buffer, src, nframes);
+    }
+
+    swap_host_buffers(This, nframes, &This->clock_cycle, 0);
+
+    /* copy host to jack buffers, unconnected outputs are cleared once so a new connection never picks up stale audio */
+    for (i = 0; i < This->host_active_outputs; i++)
+    {
+        CopyPlanEntry *entry = &This->output_plan[i];
+
+        if (!is_port_connected(This->output_connected, entry->channel))
+        {
+            if (!entry->silenced)
+            {
+                memset(jackbridge_port_get_buffer(entry->port, nframes), 0, sizeof (jack_default_audio_sample_t) * nframes);
+                entry->silenced = 1;
+            }
+            if (metering)
+                update_meter(This, &This->output_channel[entry->channel], NULL, nframes);
+            continue;
+        }
+        entry->silenced = 0;
+        dst = jackbridge_port_get_buffer(entry->port, nframes);
+        This->callback_output_convert(dst, entry->audio_buffer[index], nframes);
+        if (next_gain_ramp(entry, &This->output_channel[entry->channel], nframes, &gain, &step))
+            This->callback_gain(dst, dst, gain, step, nframes);
+        if (metering)
+            update_meter(This, &This->output_channel[entry->channel], dst, nframes);
+    }
+
+    mix_input_monitors(This, nframes);
+}
+
+/* Brackets everything a cycle does, the fence orders the flag before the reads of the driver state and the ports,
+ * against the fence in wait_for_cycle_end() */
+static inline void begin_cycle(IWineASIOImpl *This)
+{
+    __atomic_store_n(&This->jack_cycle_busy, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static inline void end_cycle(IWineASIOImpl *This)
+{
+    __atomic_store_n(&This->jack_cycle_busy, 0, __ATOMIC_RELEASE);
+}
+
+/* JACK sets its own priority after the thread init callback, so ours is applied on the first cycle */
+static inline void finish_thread_setup(IWineASIOImpl *This)
+{
+    if (!This->jack_thread_setup)
+        return;
+    This->jack_thread_setup = FALSE;
+    if (This->wineasio_thread_priority > 0)
+        set_callback_thread_priority(This->wineasio_thread_priority);
+}
+
+static inline int jack_process_callback(jack_nframes_t nframes, void *arg)
+{
+    IWineASIOImpl   *This = (IWineASIOImpl*)arg;
+    jack_time_t     start = 0;
+
+    finish_thread_setup(This);
+    begin_cycle(This);
+    if (This->metrics)
+        start = jackbridge_get_time();
+    process_cycle(This, nframes);
+    if (This->metrics)
+        update_process_metrics(This, start, jackbridge_get_time());
+    end_cycle(This);
+    return 0;
+}
+
+/* Process thread mode, the JACK thread runs this loop instead of calling the process callback.
+ * JACK is signalled as soon as the output ports are written, the metering and metrics are done after that,
+ * outside of the time the rest of the graph waits for us */
+static void *jack_process_thread(void *arg)
+{
+    IWineASIOImpl   *This = (IWineASIOImpl*)arg;
+    jack_nframes_t  nframes;
+    jack_time_t     start = 0, end;
+
+    finish_thread_setup(This);
+    while ((nframes = jackbridge_cycle_wait(This->jack_client)))
+    {
+        begin_cycle(This);
+        if (This->metrics)
+            start = jackbridge_get_time();
+        process_cycle(This, nframes);
+        jackbridge_cycle_signal(This->jack_client, 0);
+
+        if (This->metrics)
+        {
+            end = jackbridge_get_time();
+            update_process_metrics(This, start, end);
+        }
+        meter_cycle(This, nframes);
+        end_cycle(This);
+    }
+    return NULL;
+}
+
+static inline int jack_sample_rate_callback(jack_nframes_t nframes, void *arg)
+{
+    IWineASIOImpl   *This = (IWineASIOImpl*)arg;
+
+    record_trace(This, WINEASIO_TRACE_SAMPLE_RATE, nframes, 0, 0);
+    if(This->host_driver_state != Running)
+        return 0;
+
+    This->host_sample_rate = nframes;
+    This->meter_frames = 0;     /* recompute the meter release */
+    if (This->metrics)
+        __atomic_store_n(&This->metrics->sample_rate, nframes, __ATOMIC_RELAXED);
+    This->host_callbacks->sampleRateChanged(nframes);
+    return 0;
+}
+
+/* The server went away or shut the client down, after which the client must not be used but closed,
+ * which the recovery thread does. This may run on a thread of libjack's own, so nothing but an atomic store
+ * of the status and sem_post(), the reason string is not ours to keep and the recovery thread logs the status */
+static void jack_shutdown_callback(jack_status_t code, const char *reason, void *arg)
+{
+    IWineASIOImpl   *This = (IWineASIOImpl*)arg;
+
+    __atomic_store_n(&This->recovery_status, code, __ATOMIC_RELAXED);
+    sem_post(&This->recovery_semaphore);
+}
+
+/* Runs on every thread JACK creates to call us back, before its first callback */
+static void jack_thread_init_callback(void *arg)
+{
+    IWineASIOImpl   *This = (IWineASIOImpl*)arg;
+
+    setup_callback_thread(This);
+    This->jack_thread_setup = TRUE;
+}
+
+/* Only registered while publishing metrics, runs on the JACK notification thread */
+static int jack_xrun_callback(void *arg)
+{
+    IWineASIOImpl   *This = (IWineASIOImpl*)arg;
+
+    __atomic_store_n(&This->metrics->xruns, This->metrics->xruns + 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+/* Slow-sync callback, reports ready once the host has processed a buffer at the new transport position,
+ * hosts not following the time code or not running have nothing to preroll */
+static int jack_sync_callback(jack_transport_state_t state, jack_position_t *pos, void *arg)
+{
+    IWineASIOImpl   *This = (IWineASIOImpl*)arg;
+    uint64_t        buffer;
+
+    if (state != JackTransportStarting || This->host_driver_state != Running || !This->host_can_time_code)
+    {
+        This->transport_sync_pending = FALSE;
+        return 1;
+    }
+
+    buffer = __atomic_load_n(&This->host_buffer_position, __ATOMIC_ACQUIRE);
+    if (!This->transport_sync_pending || This->transport_sync_frame != pos->frame)
+    {
+        This->transport_sync_pending = TRUE;
+        This->transport_sync_frame = pos->frame;
+        This->transport_sync_buffer = buffer;
+        return 0;
+    }
+
+    if (buffer == This->transport_sync_buffer)
+        return 0;
+
+    This->transport_sync_pending = FALSE;
+    return 1;
+}
+
+/* Called from the JACK notification thread, keeps the connection bitmaps read by the process callback up to date */
+static void jack_port_connect_callback(jack_port_id_t port_a, jack_port_id_t port_b, int connect, void *arg)
+{
+    IWineASIOImpl   *This = (IWineASIOImpl*)arg;
+
+    update_port_connected(This, jackbridge_port_by_id(This->jack_client, port_a));
+    update_port_connected(This, jackbridge_port_by_id(This->jack_client, port_b));
+}
+
+/*****************************************************************************
+ *  Support functions
+ */
+
+#ifndef WINE_WITH_UNICODE
+/* Funtion required as unicode.h no longer in WINE */
+static WCHAR *strrchrW(const WCHAR* str, WCHAR ch)
+{
+    WCHAR *ret = NULL;
+    do { if (*str == ch) ret = (WCHAR *)(ULONG_PTR)str; } while (*str++);
+    return ret;
+}
+#endif
+
+/* Function called by JACK to create a thread in the wine process context,
+ *  passes a JackThreadStart to jack_thread_creator_helper(), so several threads can be created at once.
+ *  The stack size and explicit scheduling of attr are carried over, Wine does not take a pthread_attr_t */
+static int jack_thread_creator(pthread_t* thread_id, const pthread_attr_t* attr, void *(*function)(void*), void* arg)
+{
+    JackThreadStart start;
+    HANDLE          thread;
+    size_t          stack_size = 0;
+    int             inherit = PTHREAD_INHERIT_SCHED;
+
+    TRACE("arg: %p, thread_id: %p, attr: %p, function: %p\n", arg, thread_id, attr, function);
+
+    start.function = function;
+    start.arg = arg;
+    start.policy = SCHED_OTHER;
+    start.param.sched_priority = 0;
+    if (attr)
+    {
+        pthread_attr_getstacksize(attr, &stack_size);
+        pthread_attr_getinheritsched(attr, &inherit);
+        if (inherit == PTHREAD_EXPLICIT_SCHED)
+        {
+            pthread_attr_getschedpolicy(attr, &start.policy);
+            pthread_attr_getschedparam(attr, &start.param);
+        }
+    }
+
+    if (!(start.created = CreateEventW(NULL, FALSE, FALSE, NULL)))
+        return -1;
+    if (!(thread = CreateThread(NULL, stack_size, jack_thread_creator_helper, &start, 0, NULL)))
+    {
+        CloseHandle(start.created);
+        return -1;
+    }
+    WaitForSingleObject(start.created, INFINITE);
+    CloseHandle(start.created);
+    CloseHandle(thread);
+    *thread_id = start.thread_id;
+    return 0;
+}
+
+/* internal helper function for returning the posix thread_id of the newly created callback thread,
+ * start is gone once created is set */
+static DWORD WINAPI jack_thread_creator_helper(LPVOID arg)
+{
+    JackThreadStart *start = (JackThreadStart *) arg;
+    void            *(*function) (void*) = start->function;
+    void            *function_arg = start->arg;
+
+    TRACE("arg: %p\n", arg);
+
+    if (start->policy != SCHED_OTHER && pthread_setschedparam(pthread_self(), start->policy, &start->param))
+        WARN("Unable to set scheduling policy %d, priority %d for the JACK thread\n", start->policy, start->param.sched_priority);
+    start->thread_id = pthread_self();
+    SetEvent(start->created);
+    function(function_arg);
+    return 0;
+}
+
+static VOID update_port_connected(IWineASIOImpl *This, jack_port_t *port)
+{
+    uint32_t        *bitmap;
+    IOChannel       *io;
+    const char      **connections;
+    int             channel;
+
+    if (!port || __atomic_load_n(&This->jack_recovering, __ATOMIC_ACQUIRE) || !jackbridge_port_is_mine(This->jack_client, port))
+        return;
+
+    for (channel = 0; channel < This->wineasio_number_inputs; channel++)
+        if (This->input_channel[channel].port == port)
+            break;
+
+    if (channel < This->wineasio_number_inputs)
+    {
+        bitmap = This->input_connected;
+        io = &This->input_channel[channel];
+    }
+    else
+    {
+        for (channel = 0; channel < This->wineasio_number_outputs; channel++)
+            if (This->output_channel[channel].port == port)
+                break;
+        if (channel == This->wineasio_number_outputs)
+            return;
+        bitmap = This->output_connected;
+        io = &This->output_channel[channel];
+    }
+
+    if (jackbridge_port_connected(port) > 0)
+        __atomic_or_fetch(&bitmap[channel / 32], 1u << (channel % 32), __ATOMIC_RELEASE);
+    else
+        __atomic_and_fetch(&bitmap[channel / 32], ~(1u << (channel % 32)), __ATOMIC_RELEASE);
+
+    /* remembered for restoring them once the server comes back after a restart */
+    connections = jackbridge_port_get_connections(port);
+    jackbridge_free(__atomic_exchange_n(&io->connections, connections, __ATOMIC_ACQ_REL));
+}
+
+/* Registers the JACK ports of the active channels that have none yet and unregisters the ones of the others,
+ * so channels the host never uses cost the server nothing, and the ports kept keep their connections.
+ * On failure no port is left registered */
+static BOOL update_channel_ports(IWineASIOImpl *This)
+{
+    int             i;
+
+    for (i = 0; i < This->wineasio_number_inputs; i++)
+    {
+        if (!This->input_channel[i].active && This->input_channel[i].port)
+        {
+            jackbridge_port_unregister(This->jack_client, This->input_channel[i].port);
+            This->input_channel[i].port = NULL;
+            jackbridge_free(__atomic_exchange_n(&This->input_channel[i].connections, NULL, __ATOMIC_ACQ_REL));
+        }
+    }
+    for (i = 0; i < This->wineasio_number_outputs; i++)
+    {
+        if (!This->output_channel[i].active && This->output_channel[i].port)
+        {
+            jackbridge_port_unregister(This->jack_client, This->output_channel[i].port);
+            This->output_channel[i].port = NULL;
+            jackbridge_free(__atomic_exchange_n(&This->output_channel[i].connections, NULL, __ATOMIC_ACQ_REL));
+        }
+    }
+
+    for (i = 0; i < This->wineasio_number_inputs; i++)
+    {
+        if (!This->input_channel[i].active || This->input_channel[i].port)
+            continue;
+        This->input_channel[i].connect_pending = This->wineasio_connect_to_hardware;
+        This->input_channel[i].port = jackbridge_port_register(This->jack_client,
+            This->input_channel[i].port_name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, i);
+        if (!This->input_channel[i].port)
+        {
+            ERR("Unable to register JACK port %s\n", This->input_channel[i].port_name);
+            unregister_channel_ports(This);
+            return FALSE;
+        }
+    }
     for (i = 0; i < This->wineasio_number_outputs; i++)
-        if (This->output_channel[i].active)
-            memcpy(jackbridge_port_get_buffer(This->output_channel[i].port, nframes),
-                    &This->output_channel[i].audio_buffer[nframes * This->host_buffer_index],
-                    sizeof (jack_default_audio_sample_t) * nframes);
+    {
+        if (!This->output_channel[i].active || This->output_channel[i].port)
+            continue;
+        This->output_channel[i].connect_pending = This->wineasio_connect_to_hardware;
+        This->output_channel[i].port = jackbridge_port_register(This->jack_client,
+            This->output_channel[i].port_name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, i);
+        if (!This->output_channel[i].port)
+        {
+            ERR("Unable to register JACK port %s\n", This->output_channel[i].port_name);
+            unregister_channel_ports(This);
+            return FALSE;
+        }
+    }
+    TRACE("JACK ports of the active channels registered\n");
+    return TRUE;
+}
 
-    /* switch host buffer */
-    This->host_buffer_index = This->host_buffer_index ? 0 : 1;
-    return 0;
+/* Waits for the end of a JACK cycle running at the time of the call, later cycles see everything stored before.
+ * Takes the place of deactivating the client whenever the buffers or ports change under it */
+static VOID wait_for_cycle_end(IWineASIOImpl *This)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&This->jack_cycle_busy, __ATOMIC_ACQUIRE))
+        sched_yield();
 }
 
-static inline int jack_sample_rate_callback(jack_nframes_t nframes, void *arg)
+/* Unregisters the JACK ports of all channels. Their connection bits are left alone, the callbacks only
+ * look at the bits of channels with a port, and without port connect notifications they have to stay set */
+static VOID unregister_channel_ports(IWineASIOImpl *This)
 {
-    IWineASIOImpl   *This = (IWineASIOImpl*)arg;
+    int             i;
 
-    if(This->host_driver_state != Running)
-        return 0;
+    for (i = 0; i < This->wineasio_number_inputs; i++)
+    {
+        if (!This->input_channel[i].port)
+            continue;
+        jackbridge_port_unregister(This->jack_client, This->input_channel[i].port);
+        This->input_channel[i].port = NULL;
+        jackbridge_free(__atomic_exchange_n(&This->input_channel[i].connections, NULL, __ATOMIC_ACQ_REL));
+    }
+    for (i = 0; i < This->wineasio_number_outputs; i++)
+    {
+        if (!This->output_channel[i].port)
+            continue;
+        jackbridge_port_unregister(This->jack_client, This->output_channel[i].port);
+        This->output_channel[i].port = NULL;
+        jackbridge_free(__atomic_exchange_n(&This->output_channel[i].connections, NULL, __ATOMIC_ACQ_REL));
+    }
+}
 
-    This->host_sample_rate = nframes;
-    This->host_callbacks->sampleRateChanged(nframes);
-    return 0;
+/* Publishes the monitoring route of one or all inputs, the pan is equal power over the output pair */
+static VOID set_input_monitor(IWineASIOImpl *This, const InputMonitor *monitor)
+{
+    const float     gain = (float) (monitor->gain < 0 ? 0 : monitor->gain) / 0x20000000;
+    const float     pan = (float) (monitor->pan < 0 ? 0 : monitor->pan) / 0x7fffffff;
+    MonitorRoute    *route;
+    int             i, first, last;
+
+    first = monitor->input < 0 ? 0 : monitor->input;
+    last = monitor->input < 0 ? This->wineasio_number_inputs : monitor->input + 1;
+
+    seqlock_write_begin(&This->monitor_sequence);
+    for (i = first; i < last; i++)
+    {
+        route = &This->monitor_routes[i];
+        route->output[0] = route->output[1] = -1;
+        if (!monitor->state)
+            continue;
+
+        route->output[0] = monitor->output;
+        route->gain[0] = gain;
+        if (monitor->output + 1 < This->wineasio_number_outputs)
+        {
+            route->output[1] = monitor->output + 1;
+            route->gain[0] = gain * cosf(pan * (float) M_PI_2);
+            route->gain[1] = gain * sinf(pan * (float) M_PI_2);
+        }
+    }
+    seqlock_write_end(&This->monitor_sequence);
 }
 
-/*****************************************************************************
- *  Support functions
- */
+/* Accepts an ASIO sample type number or one of int16, int24, int32, float32 and float64 */
+static LONG parse_sample_type(const char *name, LONG fallback)
+{
+    static const struct { const char *name; LONG sample_type; } sample_types[] = {
+        { "int16", ASIOSTInt16LSB },
+        { "int24", ASIOSTInt24LSB },
+        { "int32", ASIOSTInt32LSB },
+        { "float32", ASIOSTFloat32LSB },
+        { "float64", ASIOSTFloat64LSB }
+    };
+    char    *end;
+    LONG    value;
+
+    for (int i = 0; i < sizeof(sample_types) / sizeof(sample_types[0]); i++)
+        if (!strcasecmp(name, sample_types[i].name))
+            return sample_types[i].sample_type;
+
+    errno = 0;
+    value = strtol(name, &end, 10);
+    if (errno != ERANGE && end != name && !*end)
+        return value;
+    return fallback;
+}
 
-#ifndef WINE_WITH_UNICODE
-/* Funtion required as unicode.h no longer in WINE */
-static WCHAR *strrchrW(const WCHAR* str, WCHAR ch)
+/* Parses a CPU list like 2,3,8-11 into set, returns FALSE if it is malformed */
+static BOOL parse_cpu_list(const char *list, cpu_set_t *set)
 {
-    WCHAR *ret = NULL;
-    do { if (*str == ch) ret = (WCHAR *)(ULONG_PTR)str; } while (*str++);
-    return ret;
+    char    *end;
+    long    first, last;
+
+    CPU_ZERO(set);
+    while (*list)
+    {
+        errno = 0;
+        first = last = strtol(list, &end, 10);
+        if (end == list || errno == ERANGE || first < 0)
+            return FALSE;
+        if (*end == '-')
+        {
+            list = end + 1;
+            last = strtol(list, &end, 10);
+            if (end == list || errno == ERANGE || last < first)
+                return FALSE;
+        }
+        if (last >= CPU_SETSIZE)
+            return FALSE;
+        for (; first <= last; first++)
+            CPU_SET(first, set);
+        if (*end == ',')
+            end++;
+        else if (*end)
+            return FALSE;
+        list = end;
+    }
+    return TRUE;
 }
-#endif
 
-/* Function called by JACK to create a thread in the wine process context,
- *  uses the global structure jack_thread_creator_privates to communicate with jack_thread_creator_helper() */
-static int jack_thread_creator(pthread_t* thread_id, const pthread_attr_t* attr, void *(*function)(void*), void* arg)
+/* Creates the shared memory segment for the metrics, the driver works without it */
+static VOID open_metrics(IWineASIOImpl *This)
 {
-    TRACE("arg: %p, thread_id: %p, attr: %p, function: %p\n", arg, thread_id, attr, function);
+    WineASIOMetrics *metrics = MAP_FAILED;
+    char            *c;
+    int             fd;
 
-    jack_thread_creator_privates.jack_callback_thread = function;
-    jack_thread_creator_privates.arg = arg;
-    jack_thread_creator_privates.jack_callback_thread_created = CreateEventW(NULL, FALSE, FALSE, NULL);
-    CreateThread( NULL, 0, jack_thread_creator_helper, arg, 0,0 );
-    WaitForSingleObject(jack_thread_creator_privates.jack_callback_thread_created, INFINITE);
-    *thread_id = jack_thread_creator_privates.jack_callback_pthread_id;
-    return 0;
+    snprintf(This->metrics_name, sizeof(This->metrics_name), "/wineasio-%s", jackbridge_get_client_name(This->jack_client));
+    for (c = This->metrics_name + 1; *c; c++)
+        if (*c == '/')
+            *c = '_';
+
+    fd = shm_open(This->metrics_name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        WARN("Unable to create the metrics shared memory %s: %s\n", This->metrics_name, strerror(errno));
+        return;
+    }
+    if (!ftruncate(fd, sizeof(WineASIOMetrics)))
+        metrics = mmap(NULL, sizeof(WineASIOMetrics), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (metrics == MAP_FAILED)
+    {
+        WARN("Unable to map the metrics shared memory %s: %s\n", This->metrics_name, strerror(errno));
+        shm_unlink(This->metrics_name);
+        return;
+    }
+
+    memset(metrics, 0, sizeof(WineASIOMetrics));
+    metrics->version = WINEASIO_METRICS_VERSION;
+    metrics->size = sizeof(WineASIOMetrics);
+    metrics->sample_rate = This->host_sample_rate;
+    metrics->host_buffer_size = This->host_current_buffersize;
+    This->metrics = metrics;
+    TRACE("Publishing metrics in %s\n", This->metrics_name);
 }
 
-/* internal helper function for returning the posix thread_id of the newly created callback thread */
-static DWORD WINAPI jack_thread_creator_helper(LPVOID arg)
+static VOID close_metrics(IWineASIOImpl *This)
 {
-    TRACE("arg: %p\n", arg);
+    if (!This->metrics)
+        return;
+    munmap(This->metrics, sizeof(WineASIOMetrics));
+    shm_unlink(This->metrics_name);
+    This->metrics = NULL;
+}
 
-    jack_thread_creator_privates.jack_callback_pthread_id = pthread_self();
-    SetEvent(jack_thread_creator_privates.jack_callback_thread_created);
-    jack_thread_creator_privates.jack_callback_thread(jack_thread_creator_privates.arg);
-    return 0;
+/* Allocates the flight recorder, and installs the trace signal handler if one is configured */
+static VOID open_trace(IWineASIOImpl *This)
+{
+    struct sigaction    action;
+    const char          *directory = getenv("TMPDIR");
+    char                *c;
+
+    This->trace_events = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, WINEASIO_TRACE_EVENTS * sizeof(WineASIOTraceEvent));
+    if (!This->trace_events)
+    {
+        WARN("Unable to allocate the flight recorder\n");
+        return;
+    }
+    This->trace_write = 0;
+    lock_memory(This->trace_events, WINEASIO_TRACE_EVENTS * sizeof(WineASIOTraceEvent));
+
+    snprintf(This->trace_path, sizeof(This->trace_path), "%s/wineasio-%s.trace", directory && *directory ? directory : "/tmp",
+             jackbridge_get_client_name(This->jack_client));
+    for (c = strrchr(This->trace_path, '/') + 1; *c; c++)
+        if (*c == '/')
+            *c = '_';
+
+    if (This->wineasio_trace_signal <= 0 || trace_instance)
+        return;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = trace_signal_handler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    trace_instance = This;
+    if (sigaction(This->wineasio_trace_signal, &action, &This->trace_old_action))
+    {
+        WARN("Unable to install the trace handler for signal %d\n", (int)This->wineasio_trace_signal);
+        trace_instance = NULL;
+        return;
+    }
+    TRACE("Signal %d dumps the flight recorder to %s\n", (int)This->wineasio_trace_signal, This->trace_path);
+}
+
+static VOID close_trace(IWineASIOImpl *This)
+{
+    if (trace_instance == This)
+    {
+        sigaction(This->wineasio_trace_signal, &This->trace_old_action, NULL);
+        trace_instance = NULL;
+    }
+    if (This->trace_events)
+    {
+        unlock_memory(This->trace_events, WINEASIO_TRACE_EVENTS * sizeof(WineASIOTraceEvent));
+        HeapFree(GetProcessHeap(), 0, This->trace_events);
+    }
+    This->trace_events = NULL;
+}
+
+/* Writes the recorded events to path, oldest first. Only uses async-signal-safe calls,
+ * events still being written or overwritten while dumping are left out */
+static BOOL dump_trace(IWineASIOImpl *This, const char *path)
+{
+    static const WineASIOTraceHeader    header = { "WASIOTRC", WINEASIO_TRACE_VERSION, sizeof(WineASIOTraceEvent) };
+    WineASIOTraceEvent                  events[64];
+    const WineASIOTraceEvent            *event;
+    uint32_t                            end, index, count = 0;
+    BOOL                                result;
+    int                                 fd;
+
+    if (!This->trace_events)
+        return FALSE;
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return FALSE;
+
+    result = write(fd, &header, sizeof(header)) == sizeof(header);
+    end = __atomic_load_n(&This->trace_write, __ATOMIC_ACQUIRE);
+    for (index = end > WINEASIO_TRACE_EVENTS ? end - WINEASIO_TRACE_EVENTS : 0; result && index != end; index++)
+    {
+        event = &This->trace_events[index & (WINEASIO_TRACE_EVENTS - 1)];
+        if (__atomic_load_n(&event->sequence, __ATOMIC_ACQUIRE) != index + 1)
+            continue;
+        events[count] = *event;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&event->sequence, __ATOMIC_RELAXED) != index + 1)
+            continue;
+        if (++count == sizeof(events) / sizeof(events[0]))
+        {
+            result = write(fd, events, sizeof(events)) == sizeof(events);
+            count = 0;
+        }
+    }
+    if (result && count)
+        result = write(fd, events, count * sizeof(events[0])) == (ssize_t) (count * sizeof(events[0]));
+    close(fd);
+    return result;
+}
+
+static VOID trace_signal_handler(int sig)
+{
+    const int   saved_errno = errno;
+
+    if (trace_instance)
+        dump_trace(trace_instance, trace_instance->trace_path);
+    errno = saved_errno;
 }
 
 static VOID configure_driver(IWineASIOImpl *This)
@@ -1394,7 +3792,9 @@ static VOID configure_driver(IWineASIOImpl *This)
     DWORD   type, size;
     WCHAR   application_path [MAX_PATH];
     WCHAR   *application_name;
-    char    environment_variable[MAX_ENVIRONMENT_SIZE];
+    char    environment_variable[WINEASIO_MAX_NAME_LENGTH];
+    char    cpu_list[256];
+    int     cpu;
 
     /* Unicode strings used for the registry */
     static const WCHAR key_software_wine_wineasio[] =
@@ -1413,20 +3813,50 @@ static VOID configure_driver(IWineASIOImpl *This)
         { 'A','u','t','o','s','t','a','r','t',' ','s','e','r','v','e','r',0 };
     static const WCHAR value_wineasio_connect_to_hardware[] =
         { 'C','o','n','n','e','c','t',' ','t','o',' ','h','a','r','d','w','a','r','e',0 };
+    static const WCHAR value_wineasio_input_sample_type[] =
+        { 'I','n','p','u','t',' ','s','a','m','p','l','e',' ','t','y','p','e',0 };
+    static const WCHAR value_wineasio_output_sample_type[] =
+        { 'O','u','t','p','u','t',' ','s','a','m','p','l','e',' ','t','y','p','e',0 };
+    static const WCHAR value_wineasio_period_adapter[] =
+        { 'P','e','r','i','o','d',' ','a','d','a','p','t','e','r',0 };
+    static const WCHAR value_wineasio_pipelined[] =
+        { 'P','i','p','e','l','i','n','e','d',' ','p','r','o','c','e','s','s','i','n','g',0 };
+    static const WCHAR value_wineasio_process_thread[] =
+        { 'P','r','o','c','e','s','s',' ','t','h','r','e','a','d',0 };
+    static const WCHAR value_wineasio_lock_all_memory[] =
+        { 'L','o','c','k',' ','a','l','l',' ','m','e','m','o','r','y',0 };
+    static const WCHAR value_wineasio_huge_pages[] =
+        { 'H','u','g','e',' ','p','a','g','e','s',0 };
+    static const WCHAR value_wineasio_trace_signal[] =
+        { 'T','r','a','c','e',' ','s','i','g','n','a','l',0 };
+    static const WCHAR value_wineasio_cpu_affinity[] =
+        { 'C','P','U',' ','a','f','f','i','n','i','t','y',0 };
+    static const WCHAR value_wineasio_thread_priority[] =
+        { 'T','h','r','e','a','d',' ','p','r','i','o','r','i','t','y',0 };
 
     /* Initialise most member variables,
-     * host_num_samples, host_time, & host_time_stamp are initialized in Start()
+     * host_sample_position, host_time & the cycle clock are initialized in Start()
      * jack_num_input_ports & jack_num_output_ports are initialized in Init() */
     This->host_active_inputs = 0;
     This->host_active_outputs = 0;
     This->host_buffer_index = 0;
     This->host_callbacks = NULL;
     This->host_can_time_code = FALSE;
+    This->host_can_buffer_size_change = FALSE;
+    This->host_output_ready = FALSE;
     This->host_current_buffersize = 0;
+    This->host_pending_buffersize = 0;
     This->host_driver_state = Loaded;
     This->host_sample_rate = 0;
     This->host_time_info_mode = FALSE;
+    This->host_input_latency = 0;
+    This->host_output_latency = 0;
     This->host_version = 92;
+    This->host_buffer_position = 0;
+    This->host_buffer_time = 0;
+    This->host_buffer_sequence = 0;
+    This->clock_sequence = 0;
+    This->clock_cycle.transport_state = JackTransportStopped;
 
     This->wineasio_number_inputs = 16;
     This->wineasio_number_outputs = 16;
@@ -1434,14 +3864,47 @@ static VOID configure_driver(IWineASIOImpl *This)
     This->wineasio_connect_to_hardware = TRUE;
     This->wineasio_fixed_buffersize = TRUE;
     This->wineasio_preferred_buffersize = WINEASIO_PREFERRED_BUFFERSIZE;
+    This->wineasio_input_sample_type = ASIOSTFloat32LSB;
+    This->wineasio_output_sample_type = ASIOSTFloat32LSB;
+    This->wineasio_period_adapter = FALSE;
+    This->wineasio_pipelined = FALSE;
+    This->wineasio_process_thread = FALSE;
+    This->wineasio_lock_all_memory = FALSE;
+    This->wineasio_huge_pages = FALSE;
+    This->wineasio_trace_signal = 0;
+    CPU_ZERO(&This->wineasio_cpu_affinity);
+    This->wineasio_thread_priority = 0;
 
     This->jack_client = NULL;
     This->jack_client_name[0] = 0;
     This->jack_input_ports = NULL;
     This->jack_output_ports = NULL;
-    This->callback_audio_buffer = NULL;
+    This->jack_active = FALSE;
+    This->connect_thread = NULL;
+    This->jack_recovering = 0;
+    This->jack_retired_client = NULL;
+    This->recovery_thread = NULL;
+    This->recovery_quit = 0;
+    This->recovery_status = 0;
+    This->jack_cycle_busy = 0;
+    This->jack_ports_changing = 0;
+    This->callback_arena = NULL;
+    This->callback_arena_size = 0;
     This->input_channel = NULL;
     This->output_channel = NULL;
+    This->input_plan = NULL;
+    This->output_plan = NULL;
+    This->input_connected = NULL;
+    This->output_connected = NULL;
+    This->metrics = NULL;
+    This->trace_events = NULL;
+    This->trace_write = 0;
+    This->adapter_buffer = NULL;
+    This->adapter_ring_size = 0;
+    This->adapter_prefill = 0;
+    This->adapter_reprime = 0;
+    This->pipeline_thread = NULL;
+    This->pipeline_output_event = NULL;
 
     /* create registry entries with defaults if not present */
     result = RegCreateKeyExW(HKEY_CURRENT_USER, key_software_wine_wineasio, 0, NULL, 0, KEY_ALL_ACCESS, NULL, &hkey, NULL);
@@ -1536,6 +3999,158 @@ static VOID configure_driver(IWineASIOImpl *This)
         result = RegSetValueExW(hkey, value_wineasio_connect_to_hardware, 0, REG_DWORD, (LPBYTE) &value, size);
     }
 
+    /* get/set the sample type of the input buffers */
+    size = sizeof(DWORD);
+    if (RegQueryValueExW(hkey, value_wineasio_input_sample_type, NULL, &type, (LPBYTE) &value, &size) == ERROR_SUCCESS)
+    {
+        if (type == REG_DWORD)
+            This->wineasio_input_sample_type = value;
+    }
+    else
+    {
+        type = REG_DWORD;
+        size = sizeof(DWORD);
+        value = This->wineasio_input_sample_type;
+        result = RegSetValueExW(hkey, value_wineasio_input_sample_type, 0, REG_DWORD, (LPBYTE) &value, size);
+    }
+
+    /* get/set the sample type of the output buffers */
+    size = sizeof(DWORD);
+    if (RegQueryValueExW(hkey, value_wineasio_output_sample_type, NULL, &type, (LPBYTE) &value, &size) == ERROR_SUCCESS)
+    {
+        if (type == REG_DWORD)
+            This->wineasio_output_sample_type = value;
+    }
+    else
+    {
+        type = REG_DWORD;
+        size = sizeof(DWORD);
+        value = This->wineasio_output_sample_type;
+        result = RegSetValueExW(hkey, value_wineasio_output_sample_type, 0, REG_DWORD, (LPBYTE) &value, size);
+    }
+
+    /* get/set the period adapter, which lets the host run at any buffer size */
+    size = sizeof(DWORD);
+    if (RegQueryValueExW(hkey, value_wineasio_period_adapter, NULL, &type, (LPBYTE) &value, &size) == ERROR_SUCCESS)
+    {
+        if (type == REG_DWORD)
+            This->wineasio_period_adapter = value;
+    }
+    else
+    {
+        type = REG_DWORD;
+        size = sizeof(DWORD);
+        value = This->wineasio_period_adapter;
+        result = RegSetValueExW(hkey, value_wineasio_period_adapter, 0, REG_DWORD, (LPBYTE) &value, size);
+    }
+
+    /* get/set pipelined processing, which runs the host on its own thread */
+    size = sizeof(DWORD);
+    if (RegQueryValueExW(hkey, value_wineasio_pipelined, NULL, &type, (LPBYTE) &value, &size) == ERROR_SUCCESS)
+    {
+        if (type == REG_DWORD)
+            This->wineasio_pipelined = value;
+    }
+    else
+    {
+        type = REG_DWORD;
+        size = sizeof(DWORD);
+        value = This->wineasio_pipelined;
+        result = RegSetValueExW(hkey, value_wineasio_pipelined, 0, REG_DWORD, (LPBYTE) &value, size);
+    }
+
+    /* get/set the process thread mode, which signals JACK before the post cycle work */
+    size = sizeof(DWORD);
+    if (RegQueryValueExW(hkey, value_wineasio_process_thread, NULL, &type, (LPBYTE) &value, &size) == ERROR_SUCCESS)
+    {
+        if (type == REG_DWORD)
+            This->wineasio_process_thread = value;
+    }
+    else
+    {
+        type = REG_DWORD;
+        size = sizeof(DWORD);
+        value = This->wineasio_process_thread;
+        result = RegSetValueExW(hkey, value_wineasio_process_thread, 0, REG_DWORD, (LPBYTE) &value, size);
+    }
+
+    /* get/set locking of all process memory, instead of only what the real time threads use */
+    size = sizeof(DWORD);
+    if (RegQueryValueExW(hkey, value_wineasio_lock_all_memory, NULL, &type, (LPBYTE) &value, &size) == ERROR_SUCCESS)
+    {
+        if (type == REG_DWORD)
+            This->wineasio_lock_all_memory = value;
+    }
+    else
+    {
+        type = REG_DWORD;
+        size = sizeof(DWORD);
+        value = This->wineasio_lock_all_memory;
+        result = RegSetValueExW(hkey, value_wineasio_lock_all_memory, 0, REG_DWORD, (LPBYTE) &value, size);
+    }
+
+    /* get/set huge pages for the audio buffers */
+    size = sizeof(DWORD);
+    if (RegQueryValueExW(hkey, value_wineasio_huge_pages, NULL, &type, (LPBYTE) &value, &size) == ERROR_SUCCESS)
+    {
+        if (type == REG_DWORD)
+            This->wineasio_huge_pages = value;
+    }
+    else
+    {
+        type = REG_DWORD;
+        size = sizeof(DWORD);
+        value = This->wineasio_huge_pages;
+        result = RegSetValueExW(hkey, value_wineasio_huge_pages, 0, REG_DWORD, (LPBYTE) &value, size);
+    }
+
+    /* get/set the signal that dumps the flight recorder, 0 for none */
+    size = sizeof(DWORD);
+    if (RegQueryValueExW(hkey, value_wineasio_trace_signal, NULL, &type, (LPBYTE) &value, &size) == ERROR_SUCCESS)
+    {
+        if (type == REG_DWORD)
+            This->wineasio_trace_signal = value;
+    }
+    else
+    {
+        type = REG_DWORD;
+        size = sizeof(DWORD);
+        value = This->wineasio_trace_signal;
+        result = RegSetValueExW(hkey, value_wineasio_trace_signal, 0, REG_DWORD, (LPBYTE) &value, size);
+    }
+
+    /* get/set the CPUs of the callback threads, a mask of CPUs 0 to 31, 0 for all */
+    size = sizeof(DWORD);
+    if (RegQueryValueExW(hkey, value_wineasio_cpu_affinity, NULL, &type, (LPBYTE) &value, &size) == ERROR_SUCCESS)
+    {
+        if (type == REG_DWORD)
+            for (cpu = 0; cpu < 32; cpu++)
+                if ((DWORD) value & (1u << cpu))
+                    CPU_SET(cpu, &This->wineasio_cpu_affinity);
+    }
+    else
+    {
+        type = REG_DWORD;
+        size = sizeof(DWORD);
+        value = 0;
+        result = RegSetValueExW(hkey, value_wineasio_cpu_affinity, 0, REG_DWORD, (LPBYTE) &value, size);
+    }
+
+    /* get/set the real time priority of the callback threads, 0 to keep the one from JACK */
+    size = sizeof(DWORD);
+    if (RegQueryValueExW(hkey, value_wineasio_thread_priority, NULL, &type, (LPBYTE) &value, &size) == ERROR_SUCCESS)
+    {
+        if (type == REG_DWORD)
+            This->wineasio_thread_priority = value;
+    }
+    else
+    {
+        type = REG_DWORD;
+        size = sizeof(DWORD);
+        value = This->wineasio_thread_priority;
+        result = RegSetValueExW(hkey, value_wineasio_thread_priority, 0, REG_DWORD, (LPBYTE) &value, size);
+    }
+
     /* get client name by stripping path and extension */
     GetModuleFileNameW(0, application_path, MAX_PATH);
     application_name = strrchrW(application_path, L'.');
@@ -1596,6 +4211,76 @@ static VOID configure_driver(IWineASIOImpl *This)
             This->wineasio_preferred_buffersize = result;
     }
 
+    if (GetEnvironmentVariableA("WINEASIO_INPUT_SAMPLE_TYPE", environment_variable, MAX_ENVIRONMENT_SIZE))
+        This->wineasio_input_sample_type = parse_sample_type(environment_variable, This->wineasio_input_sample_type);
+
+    if (GetEnvironmentVariableA("WINEASIO_OUTPUT_SAMPLE_TYPE", environment_variable, MAX_ENVIRONMENT_SIZE))
+        This->wineasio_output_sample_type = parse_sample_type(environment_variable, This->wineasio_output_sample_type);
+
+    if (GetEnvironmentVariableA("WINEASIO_PERIOD_ADAPTER", environment_variable, MAX_ENVIRONMENT_SIZE))
+    {
+        if (!strcasecmp(environment_variable, "on"))
+            This->wineasio_period_adapter = TRUE;
+        else if (!strcasecmp(environment_variable, "off"))
+            This->wineasio_period_adapter = FALSE;
+    }
+
+    if (GetEnvironmentVariableA("WINEASIO_PIPELINED", environment_variable, MAX_ENVIRONMENT_SIZE))
+    {
+        if (!strcasecmp(environment_variable, "on"))
+            This->wineasio_pipelined = TRUE;
+        else if (!strcasecmp(environment_variable, "off"))
+            This->wineasio_pipelined = FALSE;
+    }
+
+    if (GetEnvironmentVariableA("WINEASIO_PROCESS_THREAD", environment_variable, MAX_ENVIRONMENT_SIZE))
+    {
+        if (!strcasecmp(environment_variable, "on"))
+            This->wineasio_process_thread = TRUE;
+        else if (!strcasecmp(environment_variable, "off"))
+            This->wineasio_process_thread = FALSE;
+    }
+
+    if (GetEnvironmentVariableA("WINEASIO_LOCK_ALL_MEMORY", environment_variable, MAX_ENVIRONMENT_SIZE))
+    {
+        if (!strcasecmp(environment_variable, "on"))
+            This->wineasio_lock_all_memory = TRUE;
+        else if (!strcasecmp(environment_variable, "off"))
+            This->wineasio_lock_all_memory = FALSE;
+    }
+
+    if (GetEnvironmentVariableA("WINEASIO_HUGE_PAGES", environment_variable, MAX_ENVIRONMENT_SIZE))
+    {
+        if (!strcasecmp(environment_variable, "on"))
+            This->wineasio_huge_pages = TRUE;
+        else if (!strcasecmp(environment_variable, "off"))
+            This->wineasio_huge_pages = FALSE;
+    }
+
+    if (GetEnvironmentVariableA("WINEASIO_TRACE_SIGNAL", environment_variable, MAX_ENVIRONMENT_SIZE))
+    {
+        errno = 0;
+        result = strtol(environment_variable, 0, 10);
+        if (errno != ERANGE)
+            This->wineasio_trace_signal = result;
+    }
+
+    /* a CPU list, not limited to the first 32 CPUs like the registry mask */
+    size = GetEnvironmentVariableA("WINEASIO_CPU_AFFINITY", cpu_list, sizeof(cpu_list));
+    if (size > 0 && size < sizeof(cpu_list) && !parse_cpu_list(cpu_list, &This->wineasio_cpu_affinity))
+    {
+        WARN("Invalid CPU list '%s', the callback threads are not pinned\n", cpu_list);
+        CPU_ZERO(&This->wineasio_cpu_affinity);
+    }
+
+    if (GetEnvironmentVariableA("WINEASIO_THREAD_PRIORITY", environment_variable, MAX_ENVIRONMENT_SIZE))
+    {
+        errno = 0;
+        result = strtol(environment_variable, 0, 10);
+        if (errno != ERANGE)
+            This->wineasio_thread_priority = result;
+    }
+
     /* over ride the JACK client name gotten from the application name */
     size = GetEnvironmentVariableA("WINEASIO_CLIENT_NAME", environment_variable, WINEASIO_MAX_NAME_LENGTH);
     if (size > 0 && size < WINEASIO_MAX_NAME_LENGTH)
@@ -1607,6 +4292,18 @@ static VOID configure_driver(IWineASIOImpl *This)
             && This->wineasio_preferred_buffersize <= WINEASIO_MAXIMUM_BUFFERSIZE))
         This->wineasio_preferred_buffersize = WINEASIO_PREFERRED_BUFFERSIZE;
 
+    /* fall back to 32 bit float for sample types without a conversion */
+    if (!dsp_sample_size(This->wineasio_input_sample_type))
+    {
+        WARN("Unsupported input sample type %d, using Float32LSB\n", (int)This->wineasio_input_sample_type);
+        This->wineasio_input_sample_type = ASIOSTFloat32LSB;
+    }
+    if (!dsp_sample_size(This->wineasio_output_sample_type))
+    {
+        WARN("Unsupported output sample type %d, using Float32LSB\n", (int)This->wineasio_output_sample_type);
+        This->wineasio_output_sample_type = ASIOSTFloat32LSB;
+    }
+
     return;
 }
 
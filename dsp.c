@@ -0,0 +1,789 @@
+/*
+ * Copyright (C) 2026 WineASIO contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "dsp.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#define DSP_X86 1
+#endif
+
+/* kernels are picked once per sample type, by the highest level the CPU supports */
+enum { DSP_SCALAR, DSP_SSE2, DSP_AVX2, DSP_AVX512 };
+
+#define DSP_INT16_SCALE     32768.0f
+#define DSP_INT24_SCALE     8388608.0f
+#define DSP_INT32_SCALE     2147483648.0f
+#define DSP_INT32_MAX_FLOAT 2147483520.0f /* largest float below 2^31 */
+
+// --------------------------------------------------------------------------------------------------------------------
+// scalar kernels, also used for the tails of the vector loops
+
+static inline int32_t float_to_int(float sample, double scale, int32_t max)
+{
+    const double value = sample * scale;
+
+    if (value >= max)
+        return max;
+    if (value <= -scale)
+        return (int32_t) -scale;
+    if (value != value) /* NaN */
+        return 0;
+    return (int32_t) (value < 0 ? value - 0.5 : value + 0.5);
+}
+
+static inline void int16_from_float_tail(int16_t *dst, const float *src, unsigned int i, unsigned int frames)
+{
+    for (; i < frames; i++)
+        dst[i] = float_to_int(src[i], DSP_INT16_SCALE, INT16_MAX);
+}
+
+static inline void int16_to_float_tail(float *dst, const int16_t *src, unsigned int i, unsigned int frames)
+{
+    for (; i < frames; i++)
+        dst[i] = src[i] * (1.0f / DSP_INT16_SCALE);
+}
+
+static inline void int24_from_float_tail(uint8_t *dst, const float *src, unsigned int i, unsigned int frames)
+{
+    for (; i < frames; i++)
+    {
+        const int32_t value = float_to_int(src[i], DSP_INT24_SCALE, 8388607);
+        dst[i * 3 + 0] = value;
+        dst[i * 3 + 1] = value >> 8;
+        dst[i * 3 + 2] = value >> 16;
+    }
+}
+
+static inline void int24_to_float_tail(float *dst, const uint8_t *src, unsigned int i, unsigned int frames)
+{
+    for (; i < frames; i++)
+    {
+        const int32_t value = (int32_t) ((uint32_t) src[i * 3] << 8 | (uint32_t) src[i * 3 + 1] << 16 | (uint32_t) src[i * 3 + 2] << 24) >> 8;
+        dst[i] = value * (1.0f / DSP_INT24_SCALE);
+    }
+}
+
+static inline void int32_from_float_tail(int32_t *dst, const float *src, unsigned int i, unsigned int frames)
+{
+    for (; i < frames; i++)
+        dst[i] = float_to_int(src[i], DSP_INT32_SCALE, INT32_MAX);
+}
+
+static inline void int32_to_float_tail(float *dst, const int32_t *src, unsigned int i, unsigned int frames)
+{
+    for (; i < frames; i++)
+        dst[i] = src[i] * (1.0f / DSP_INT32_SCALE);
+}
+
+static inline void float64_from_float_tail(double *dst, const float *src, unsigned int i, unsigned int frames)
+{
+    for (; i < frames; i++)
+        dst[i] = src[i];
+}
+
+static inline void float64_to_float_tail(float *dst, const double *src, unsigned int i, unsigned int frames)
+{
+    for (; i < frames; i++)
+        dst[i] = src[i];
+}
+
+static inline void mix_tail(float *dst, const float *src, float gain, unsigned int i, unsigned int frames)
+{
+    for (; i < frames; i++)
+        dst[i] += src[i] * gain;
+}
+
+static inline void gain_tail(float *dst, const float *src, float gain, float step, unsigned int i, unsigned int frames)
+{
+    for (; i < frames; i++)
+        dst[i] = src[i] * (gain + step * i);
+}
+
+static void float32_from_float(void *dst, const float *src, unsigned int frames)
+{
+    memcpy(dst, src, sizeof(float) * frames);
+}
+
+static void float32_to_float(float *dst, const void *src, unsigned int frames)
+{
+    memcpy(dst, src, sizeof(float) * frames);
+}
+
+static void int16_from_float_c(void *dst, const float *src, unsigned int frames)
+{
+    int16_from_float_tail(dst, src, 0, frames);
+}
+
+static void int16_to_float_c(float *dst, const void *src, unsigned int frames)
+{
+    int16_to_float_tail(dst, src, 0, frames);
+}
+
+static void int24_from_float_c(void *dst, const float *src, unsigned int frames)
+{
+    int24_from_float_tail(dst, src, 0, frames);
+}
+
+static void int24_to_float_c(float *dst, const void *src, unsigned int frames)
+{
+    int24_to_float_tail(dst, src, 0, frames);
+}
+
+static void int32_from_float_c(void *dst, const float *src, unsigned int frames)
+{
+    int32_from_float_tail(dst, src, 0, frames);
+}
+
+static void int32_to_float_c(float *dst, const void *src, unsigned int frames)
+{
+    int32_to_float_tail(dst, src, 0, frames);
+}
+
+static void float64_from_float_c(void *dst, const float *src, unsigned int frames)
+{
+    float64_from_float_tail(dst, src, 0, frames);
+}
+
+static void float64_to_float_c(float *dst, const void *src, unsigned int frames)
+{
+    float64_to_float_tail(dst, src, 0, frames);
+}
+
+/* folds the vector lanes of a meter kernel together, then meters the remaining frames */
+static inline void meter_tail(const float *src, const float *peaks, const float *sums, unsigned int lanes,
+                              unsigned int i, unsigned int frames, float *peak, float *sum)
+{
+    float max = 0.0f, total = 0.0f;
+    unsigned int j;
+
+    for (j = 0; j < lanes; j++)
+    {
+        if (peaks[j] > max)
+            max = peaks[j];
+        total += sums[j];
+    }
+    for (; i < frames; i++)
+    {
+        const float value = src[i] < 0.0f ? -src[i] : src[i];
+
+        if (value > max)
+            max = value;
+        total += src[i] * src[i];
+    }
+    *peak = max;
+    *sum = total;
+}
+
+static void mix_c(float *dst, const float *src, float gain, unsigned int frames)
+{
+    mix_tail(dst, src, gain, 0, frames);
+}
+
+static void gain_c(float *dst, const float *src, float gain, float step, unsigned int frames)
+{
+    gain_tail(dst, src, gain, step, 0, frames);
+}
+
+static void meter_c(const float *src, unsigned int frames, float *peak, float *sum)
+{
+    meter_tail(src, NULL, NULL, 0, 0, frames, peak, sum);
+}
+
+#ifdef DSP_X86
+
+// --------------------------------------------------------------------------------------------------------------------
+// SSE2 kernels, 4 frames per step
+
+__attribute__((target("sse2")))
+static inline __m128i scale_sse2(const float *src, float scale, float max)
+{
+    // NaN lanes are zeroed first like float_to_int() does, max_ps would turn them into full scale negative
+    const __m128 samples = _mm_loadu_ps(src);
+    const __m128 ordered = _mm_and_ps(samples, _mm_cmpord_ps(samples, samples));
+    const __m128 clamped = _mm_min_ps(_mm_max_ps(ordered, _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+    return _mm_cvtps_epi32(_mm_min_ps(_mm_mul_ps(clamped, _mm_set1_ps(scale)), _mm_set1_ps(max)));
+}
+
+__attribute__((target("sse2")))
+static void int16_from_float_sse2(void *dst, const float *src, unsigned int frames)
+{
+    int16_t *out = dst;
+    unsigned int i;
+
+    /* packs_epi32 saturates +1.0 to INT16_MAX */
+    for (i = 0; i + 8 <= frames; i += 8)
+        _mm_storeu_si128((__m128i *) (out + i), _mm_packs_epi32(scale_sse2(src + i, DSP_INT16_SCALE, DSP_INT16_SCALE),
+                                                                scale_sse2(src + i + 4, DSP_INT16_SCALE, DSP_INT16_SCALE)));
+    int16_from_float_tail(out, src, i, frames);
+}
+
+__attribute__((target("sse2")))
+static void int16_to_float_sse2(float *dst, const void *src, unsigned int frames)
+{
+    const int16_t *in = src;
+    const __m128 scale = _mm_set1_ps(1.0f / DSP_INT16_SCALE);
+    unsigned int i;
+
+    for (i = 0; i + 8 <= frames; i += 8)
+    {
+        const __m128i samples = _mm_loadu_si128((const __m128i *) (in + i));
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16)), scale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16)), scale));
+    }
+    int16_to_float_tail(dst, in, i, frames);
+}
+
+__attribute__((target("sse2")))
+static void int24_from_float_sse2(void *dst, const float *src, unsigned int frames)
+{
+    uint8_t *out = dst;
+    int32_t values[4];
+    unsigned int i;
+
+    /* SSE2 has no byte shuffle, only the conversion is vectorized here */
+    for (i = 0; i + 4 <= frames; i += 4)
+    {
+        _mm_storeu_si128((__m128i *) values, scale_sse2(src + i, DSP_INT24_SCALE, 8388607.0f));
+        for (int j = 0; j < 4; j++)
+        {
+            out[(i + j) * 3 + 0] = values[j];
+            out[(i + j) * 3 + 1] = values[j] >> 8;
+            out[(i + j) * 3 + 2] = values[j] >> 16;
+        }
+    }
+    int24_from_float_tail(out, src, i, frames);
+}
+
+__attribute__((target("sse2")))
+static void int32_from_float_sse2(void *dst, const float *src, unsigned int frames)
+{
+    int32_t *out = dst;
+    unsigned int i;
+
+    for (i = 0; i + 4 <= frames; i += 4)
+        _mm_storeu_si128((__m128i *) (out + i), scale_sse2(src + i, DSP_INT32_SCALE, DSP_INT32_MAX_FLOAT));
+    int32_from_float_tail(out, src, i, frames);
+}
+
+__attribute__((target("sse2")))
+static void int32_to_float_sse2(float *dst, const void *src, unsigned int frames)
+{
+    const int32_t *in = src;
+    const __m128 scale = _mm_set1_ps(1.0f / DSP_INT32_SCALE);
+    unsigned int i;
+
+    for (i = 0; i + 4 <= frames; i += 4)
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *) (in + i))), scale));
+    int32_to_float_tail(dst, in, i, frames);
+}
+
+__attribute__((target("sse2")))
+static void float64_from_float_sse2(void *dst, const float *src, unsigned int frames)
+{
+    double *out = dst;
+    unsigned int i;
+
+    for (i = 0; i + 4 <= frames; i += 4)
+    {
+        const __m128 samples = _mm_loadu_ps(src + i);
+        _mm_storeu_pd(out + i, _mm_cvtps_pd(samples));
+        _mm_storeu_pd(out + i + 2, _mm_cvtps_pd(_mm_movehl_ps(samples, samples)));
+    }
+    float64_from_float_tail(out, src, i, frames);
+}
+
+__attribute__((target("sse2")))
+static void float64_to_float_sse2(float *dst, const void *src, unsigned int frames)
+{
+    const double *in = src;
+    unsigned int i;
+
+    for (i = 0; i + 4 <= frames; i += 4)
+        _mm_storeu_ps(dst + i, _mm_movelh_ps(_mm_cvtpd_ps(_mm_loadu_pd(in + i)), _mm_cvtpd_ps(_mm_loadu_pd(in + i + 2))));
+    float64_to_float_tail(dst, in, i, frames);
+}
+
+__attribute__((target("sse2")))
+static void mix_sse2(float *dst, const float *src, float gain, unsigned int frames)
+{
+    const __m128 scale = _mm_set1_ps(gain);
+    unsigned int i;
+
+    for (i = 0; i + 4 <= frames; i += 4)
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), scale)));
+    mix_tail(dst, src, gain, i, frames);
+}
+
+__attribute__((target("sse2")))
+static void gain_sse2(float *dst, const float *src, float gain, float step, unsigned int frames)
+{
+    const __m128 steps = _mm_set1_ps(step * 4);
+    __m128 gains = _mm_add_ps(_mm_set1_ps(gain), _mm_mul_ps(_mm_set_ps(3, 2, 1, 0), _mm_set1_ps(step)));
+    unsigned int i;
+
+    for (i = 0; i + 4 <= frames; i += 4)
+    {
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(src + i), gains));
+        gains = _mm_add_ps(gains, steps);
+    }
+    gain_tail(dst, src, gain, step, i, frames);
+}
+
+__attribute__((target("sse2")))
+static void meter_sse2(const float *src, unsigned int frames, float *peak, float *sum)
+{
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 peaks = _mm_setzero_ps(), sums = _mm_setzero_ps();
+    float peak_lanes[4], sum_lanes[4];
+    unsigned int i;
+
+    for (i = 0; i + 4 <= frames; i += 4)
+    {
+        const __m128 value = _mm_loadu_ps(src + i);
+
+        peaks = _mm_max_ps(peaks, _mm_andnot_ps(sign, value));
+        sums = _mm_add_ps(sums, _mm_mul_ps(value, value));
+    }
+    _mm_storeu_ps(peak_lanes, peaks);
+    _mm_storeu_ps(sum_lanes, sums);
+    meter_tail(src, peak_lanes, sum_lanes, 4, i, frames, peak, sum);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// AVX2 kernels, 8 frames per step
+
+__attribute__((target("avx2")))
+static inline __m256i scale_avx2(const float *src, float scale, float max)
+{
+    const __m256 samples = _mm256_loadu_ps(src);
+    const __m256 ordered = _mm256_and_ps(samples, _mm256_cmp_ps(samples, samples, _CMP_ORD_Q));
+    const __m256 clamped = _mm256_min_ps(_mm256_max_ps(ordered, _mm256_set1_ps(-1.0f)), _mm256_set1_ps(1.0f));
+    return _mm256_cvtps_epi32(_mm256_min_ps(_mm256_mul_ps(clamped, _mm256_set1_ps(scale)), _mm256_set1_ps(max)));
+}
+
+__attribute__((target("avx2")))
+static void int16_from_float_avx2(void *dst, const float *src, unsigned int frames)
+{
+    int16_t *out = dst;
+    unsigned int i;
+
+    for (i = 0; i + 16 <= frames; i += 16)
+    {
+        /* packs works per 128 bit lane, restore the sample order afterwards */
+        const __m256i packed = _mm256_packs_epi32(scale_avx2(src + i, DSP_INT16_SCALE, DSP_INT16_SCALE),
+                                                  scale_avx2(src + i + 8, DSP_INT16_SCALE, DSP_INT16_SCALE));
+        _mm256_storeu_si256((__m256i *) (out + i), _mm256_permute4x64_epi64(packed, 0xd8));
+    }
+    int16_from_float_tail(out, src, i, frames);
+}
+
+__attribute__((target("avx2")))
+static void int16_to_float_avx2(float *dst, const void *src, unsigned int frames)
+{
+    const int16_t *in = src;
+    const __m256 scale = _mm256_set1_ps(1.0f / DSP_INT16_SCALE);
+    unsigned int i;
+
+    for (i = 0; i + 8 <= frames; i += 8)
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (in + i)))), scale));
+    int16_to_float_tail(dst, in, i, frames);
+}
+
+__attribute__((target("avx2")))
+static void int24_from_float_avx2(void *dst, const float *src, unsigned int frames)
+{
+    const __m256i pack = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                          0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    uint8_t *out = dst;
+    unsigned int i;
+
+    /* each 128 bit lane packs 4 samples into its low 12 bytes, which are stored without touching the next frames */
+    for (i = 0; i + 8 <= frames; i += 8)
+    {
+        const __m256i packed = _mm256_shuffle_epi8(scale_avx2(src + i, DSP_INT24_SCALE, 8388607.0f), pack);
+        const __m128i low = _mm256_castsi256_si128(packed);
+        const __m128i high = _mm256_extracti128_si256(packed, 1);
+        const uint32_t low_tail = _mm_cvtsi128_si32(_mm_srli_si128(low, 8));
+        const uint32_t high_tail = _mm_cvtsi128_si32(_mm_srli_si128(high, 8));
+
+        _mm_storel_epi64((__m128i *) (out + i * 3), low);
+        memcpy(out + i * 3 + 8, &low_tail, 4);
+        _mm_storel_epi64((__m128i *) (out + i * 3 + 12), high);
+        memcpy(out + i * 3 + 20, &high_tail, 4);
+    }
+    int24_from_float_tail(out, src, i, frames);
+}
+
+__attribute__((target("avx2")))
+static void int24_to_float_avx2(float *dst, const void *src, unsigned int frames)
+{
+    const __m128i unpack = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+    const __m256 scale = _mm256_set1_ps(1.0f / DSP_INT24_SCALE);
+    const uint8_t *in = src;
+    unsigned int i;
+
+    /* the 16 byte loads read 4 bytes past the 8 frames, so keep 2 frames for the tail */
+    for (i = 0; i + 10 <= frames; i += 8)
+    {
+        const __m128i low = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (in + i * 3)), unpack);
+        const __m128i high = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (in + i * 3 + 12)), unpack);
+        const __m256i samples = _mm256_srai_epi32(_mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1), 8);
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(samples), scale));
+    }
+    int24_to_float_tail(dst, in, i, frames);
+}
+
+__attribute__((target("avx2")))
+static void int32_from_float_avx2(void *dst, const float *src, unsigned int frames)
+{
+    int32_t *out = dst;
+    unsigned int i;
+
+    for (i = 0; i + 8 <= frames; i += 8)
+        _mm256_storeu_si256((__m256i *) (out + i), scale_avx2(src + i, DSP_INT32_SCALE, DSP_INT32_MAX_FLOAT));
+    int32_from_float_tail(out, src, i, frames);
+}
+
+__attribute__((target("avx2")))
+static void int32_to_float_avx2(float *dst, const void *src, unsigned int frames)
+{
+    const int32_t *in = src;
+    const __m256 scale = _mm256_set1_ps(1.0f / DSP_INT32_SCALE);
+    unsigned int i;
+
+    for (i = 0; i + 8 <= frames; i += 8)
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i *) (in + i))), scale));
+    int32_to_float_tail(dst, in, i, frames);
+}
+
+__attribute__((target("avx2")))
+static void float64_from_float_avx2(void *dst, const float *src, unsigned int frames)
+{
+    double *out = dst;
+    unsigned int i;
+
+    for (i = 0; i + 4 <= frames; i += 4)
+        _mm256_storeu_pd(out + i, _mm256_cvtps_pd(_mm_loadu_ps(src + i)));
+    float64_from_float_tail(out, src, i, frames);
+}
+
+__attribute__((target("avx2")))
+static void float64_to_float_avx2(float *dst, const void *src, unsigned int frames)
+{
+    const double *in = src;
+    unsigned int i;
+
+    for (i = 0; i + 4 <= frames; i += 4)
+        _mm_storeu_ps(dst + i, _mm256_cvtpd_ps(_mm256_loadu_pd(in + i)));
+    float64_to_float_tail(dst, in, i, frames);
+}
+
+__attribute__((target("avx2")))
+static void mix_avx2(float *dst, const float *src, float gain, unsigned int frames)
+{
+    const __m256 scale = _mm256_set1_ps(gain);
+    unsigned int i;
+
+    for (i = 0; i + 8 <= frames; i += 8)
+        _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_mul_ps(_mm256_loadu_ps(src + i), scale)));
+    mix_tail(dst, src, gain, i, frames);
+}
+
+__attribute__((target("avx2")))
+static void gain_avx2(float *dst, const float *src, float gain, float step, unsigned int frames)
+{
+    const __m256 steps = _mm256_set1_ps(step * 8);
+    __m256 gains = _mm256_add_ps(_mm256_set1_ps(gain), _mm256_mul_ps(_mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0), _mm256_set1_ps(step)));
+    unsigned int i;
+
+    for (i = 0; i + 8 <= frames; i += 8)
+    {
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(src + i), gains));
+        gains = _mm256_add_ps(gains, steps);
+    }
+    gain_tail(dst, src, gain, step, i, frames);
+}
+
+__attribute__((target("avx2")))
+static void meter_avx2(const float *src, unsigned int frames, float *peak, float *sum)
+{
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    __m256 peaks = _mm256_setzero_ps(), sums = _mm256_setzero_ps();
+    float peak_lanes[8], sum_lanes[8];
+    unsigned int i;
+
+    for (i = 0; i + 8 <= frames; i += 8)
+    {
+        const __m256 value = _mm256_loadu_ps(src + i);
+
+        peaks = _mm256_max_ps(peaks, _mm256_andnot_ps(sign, value));
+        sums = _mm256_add_ps(sums, _mm256_mul_ps(value, value));
+    }
+    _mm256_storeu_ps(peak_lanes, peaks);
+    _mm256_storeu_ps(sum_lanes, sums);
+    meter_tail(src, peak_lanes, sum_lanes, 8, i, frames, peak, sum);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// AVX-512 kernels, 16 frames per step (packed 24 bit uses the AVX2 kernels)
+
+__attribute__((target("avx512f")))
+static inline __m512i scale_avx512(const float *src, float scale, float max)
+{
+    const __m512 samples = _mm512_loadu_ps(src);
+    const __m512 ordered = _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(samples, samples, _CMP_ORD_Q), samples);
+    const __m512 clamped = _mm512_min_ps(_mm512_max_ps(ordered, _mm512_set1_ps(-1.0f)), _mm512_set1_ps(1.0f));
+    return _mm512_cvtps_epi32(_mm512_min_ps(_mm512_mul_ps(clamped, _mm512_set1_ps(scale)), _mm512_set1_ps(max)));
+}
+
+__attribute__((target("avx512f")))
+static void int16_from_float_avx512(void *dst, const float *src, unsigned int frames)
+{
+    int16_t *out = dst;
+    unsigned int i;
+
+    for (i = 0; i + 16 <= frames; i += 16)
+        _mm256_storeu_si256((__m256i *) (out + i), _mm512_cvtsepi32_epi16(scale_avx512(src + i, DSP_INT16_SCALE, DSP_INT16_SCALE)));
+    int16_from_float_tail(out, src, i, frames);
+}
+
+__attribute__((target("avx512f")))
+static void int16_to_float_avx512(float *dst, const void *src, unsigned int frames)
+{
+    const int16_t *in = src;
+    const __m512 scale = _mm512_set1_ps(1.0f / DSP_INT16_SCALE);
+    unsigned int i;
+
+    for (i = 0; i + 16 <= frames; i += 16)
+        _mm512_storeu_ps(dst + i, _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(_mm256_loadu_si256((const __m256i *) (in + i)))), scale));
+    int16_to_float_tail(dst, in, i, frames);
+}
+
+__attribute__((target("avx512f")))
+static void int32_from_float_avx512(void *dst, const float *src, unsigned int frames)
+{
+    int32_t *out = dst;
+    unsigned int i;
+
+    for (i = 0; i + 16 <= frames; i += 16)
+        _mm512_storeu_si512((void *) (out + i), scale_avx512(src + i, DSP_INT32_SCALE, DSP_INT32_MAX_FLOAT));
+    int32_from_float_tail(out, src, i, frames);
+}
+
+__attribute__((target("avx512f")))
+static void int32_to_float_avx512(float *dst, const void *src, unsigned int frames)
+{
+    const int32_t *in = src;
+    const __m512 scale = _mm512_set1_ps(1.0f / DSP_INT32_SCALE);
+    unsigned int i;
+
+    for (i = 0; i + 16 <= frames; i += 16)
+        _mm512_storeu_ps(dst + i, _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_loadu_si512((const void *) (in + i))), scale));
+    int32_to_float_tail(dst, in, i, frames);
+}
+
+__attribute__((target("avx512f")))
+static void float64_from_float_avx512(void *dst, const float *src, unsigned int frames)
+{
+    double *out = dst;
+    unsigned int i;
+
+    for (i = 0; i + 8 <= frames; i += 8)
+        _mm512_storeu_pd(out + i, _mm512_cvtps_pd(_mm256_loadu_ps(src + i)));
+    float64_from_float_tail(out, src, i, frames);
+}
+
+__attribute__((target("avx512f")))
+static void float64_to_float_avx512(float *dst, const void *src, unsigned int frames)
+{
+    const double *in = src;
+    unsigned int i;
+
+    for (i = 0; i + 8 <= frames; i += 8)
+        _mm256_storeu_ps(dst + i, _mm512_cvtpd_ps(_mm512_loadu_pd(in + i)));
+    float64_to_float_tail(dst, in, i, frames);
+}
+
+__attribute__((target("avx512f")))
+static void mix_avx512(float *dst, const float *src, float gain, unsigned int frames)
+{
+    const __m512 scale = _mm512_set1_ps(gain);
+    unsigned int i;
+
+    for (i = 0; i + 16 <= frames; i += 16)
+        _mm512_storeu_ps(dst + i, _mm512_add_ps(_mm512_loadu_ps(dst + i), _mm512_mul_ps(_mm512_loadu_ps(src + i), scale)));
+    mix_tail(dst, src, gain, i, frames);
+}
+
+__attribute__((target("avx512f")))
+static void gain_avx512(float *dst, const float *src, float gain, float step, unsigned int frames)
+{
+    const __m512 steps = _mm512_set1_ps(step * 16);
+    __m512 gains = _mm512_add_ps(_mm512_set1_ps(gain), _mm512_mul_ps(_mm512_set_ps(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0),
+                                                                     _mm512_set1_ps(step)));
+    unsigned int i;
+
+    for (i = 0; i + 16 <= frames; i += 16)
+    {
+        _mm512_storeu_ps(dst + i, _mm512_mul_ps(_mm512_loadu_ps(src + i), gains));
+        gains = _mm512_add_ps(gains, steps);
+    }
+    gain_tail(dst, src, gain, step, i, frames);
+}
+
+__attribute__((target("avx512f")))
+static void meter_avx512(const float *src, unsigned int frames, float *peak, float *sum)
+{
+    __m512 peaks = _mm512_setzero_ps(), sums = _mm512_setzero_ps();
+    float peak_lanes[16], sum_lanes[16];
+    unsigned int i;
+
+    for (i = 0; i + 16 <= frames; i += 16)
+    {
+        const __m512 value = _mm512_loadu_ps(src + i);
+
+        peaks = _mm512_max_ps(peaks, _mm512_abs_ps(value));
+        sums = _mm512_fmadd_ps(value, value, sums);
+    }
+    _mm512_storeu_ps(peak_lanes, peaks);
+    _mm512_storeu_ps(sum_lanes, sums);
+    meter_tail(src, peak_lanes, sum_lanes, 16, i, frames, peak, sum);
+}
+
+#endif // DSP_X86
+
+// --------------------------------------------------------------------------------------------------------------------
+
+static int dsp_get_level(void)
+{
+    static int level = -1;
+
+    if (level < 0)
+    {
+#ifdef DSP_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+            level = DSP_AVX512;
+        else if (__builtin_cpu_supports("avx2"))
+            level = DSP_AVX2;
+        else if (__builtin_cpu_supports("sse2"))
+            level = DSP_SSE2;
+        else
+#endif
+            level = DSP_SCALAR;
+    }
+    return level;
+}
+
+#ifdef DSP_X86
+#define DSP_PICK(c, sse2, avx2, avx512) \
+    (dsp_get_level() >= DSP_AVX512 ? (avx512) : dsp_get_level() >= DSP_AVX2 ? (avx2) : dsp_get_level() >= DSP_SSE2 ? (sse2) : (c))
+#else
+#define DSP_PICK(c, sse2, avx2, avx512) (c)
+#endif
+
+int dsp_sample_size(int sample_type)
+{
+    switch (sample_type)
+    {
+        case ASIOSTInt16LSB:
+            return 2;
+        case ASIOSTInt24LSB:
+            return 3;
+        case ASIOSTInt32LSB:
+        case ASIOSTFloat32LSB:
+            return 4;
+        case ASIOSTFloat64LSB:
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+dsp_from_float_func dsp_get_from_float(int sample_type)
+{
+    switch (sample_type)
+    {
+        case ASIOSTInt16LSB:
+            return DSP_PICK(int16_from_float_c, int16_from_float_sse2, int16_from_float_avx2, int16_from_float_avx512);
+        case ASIOSTInt24LSB:
+            return DSP_PICK(int24_from_float_c, int24_from_float_sse2, int24_from_float_avx2, int24_from_float_avx2);
+        case ASIOSTInt32LSB:
+            return DSP_PICK(int32_from_float_c, int32_from_float_sse2, int32_from_float_avx2, int32_from_float_avx512);
+        case ASIOSTFloat32LSB:
+            return float32_from_float;
+        case ASIOSTFloat64LSB:
+            return DSP_PICK(float64_from_float_c, float64_from_float_sse2, float64_from_float_avx2, float64_from_float_avx512);
+        default:
+            return NULL;
+    }
+}
+
+dsp_to_float_func dsp_get_to_float(int sample_type)
+{
+    switch (sample_type)
+    {
+        case ASIOSTInt16LSB:
+            return DSP_PICK(int16_to_float_c, int16_to_float_sse2, int16_to_float_avx2, int16_to_float_avx512);
+        case ASIOSTInt24LSB:
+            /* SSE2 has no byte shuffle to unpack with */
+            return DSP_PICK(int24_to_float_c, int24_to_float_c, int24_to_float_avx2, int24_to_float_avx2);
+        case ASIOSTInt32LSB:
+            return DSP_PICK(int32_to_float_c, int32_to_float_sse2, int32_to_float_avx2, int32_to_float_avx512);
+        case ASIOSTFloat32LSB:
+            return float32_to_float;
+        case ASIOSTFloat64LSB:
+            return DSP_PICK(float64_to_float_c, float64_to_float_sse2, float64_to_float_avx2, float64_to_float_avx512);
+        default:
+            return NULL;
+    }
+}
+
+dsp_mix_func dsp_get_mix(void)
+{
+    return DSP_PICK(mix_c, mix_sse2, mix_avx2, mix_avx512);
+}
+
+dsp_gain_func dsp_get_gain(void)
+{
+    return DSP_PICK(gain_c, gain_sse2, gain_avx2, gain_avx512);
+}
+
+dsp_meter_func dsp_get_meter(void)
+{
+    return DSP_PICK(meter_c, meter_sse2, meter_avx2, meter_avx512);
+}
+
+const char* dsp_get_isa_name(void)
+{
+    switch (dsp_get_level())
+    {
+        case DSP_AVX512:
+            return "AVX-512";
+        case DSP_AVX2:
+            return "AVX2";
+        case DSP_SSE2:
+            return "SSE2";
+        default:
+            return "scalar";
+    }
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2026 WineASIO contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/* ASIO sample types WineASIO can present to the host (little endian only) */
+enum {
+    ASIOSTInt16LSB   = 16,
+    ASIOSTInt24LSB   = 17,  /* packed, 3 bytes per sample */
+    ASIOSTInt32LSB   = 18,
+    ASIOSTFloat32LSB = 19,
+    ASIOSTFloat64LSB = 20
+};
+
+/* Convert frames of JACK float audio into a host buffer, and back */
+typedef void (*dsp_from_float_func)(void *dst, const float *src, unsigned int frames);
+typedef void (*dsp_to_float_func)(float *dst, const void *src, unsigned int frames);
+
+/* Add frames of float audio, scaled by gain, to dst */
+typedef void (*dsp_mix_func)(float *dst, const float *src, float gain, unsigned int frames);
+
+/* Scale frames of float audio by a gain ramping linearly from gain by step per frame, dst may be src */
+typedef void (*dsp_gain_func)(float *dst, const float *src, float gain, float step, unsigned int frames);
+
+/* Return the largest absolute value and the sum of squares of frames of float audio */
+typedef void (*dsp_meter_func)(const float *src, unsigned int frames, float *peak, float *sum);
+
+/* Returns the size in bytes of one sample, or 0 if the sample type is not supported */
+int dsp_sample_size(int sample_type);
+
+/* Return the fastest kernel the CPU supports for the sample type, or NULL if the type is not supported */
+dsp_from_float_func dsp_get_from_float(int sample_type);
+dsp_to_float_func   dsp_get_to_float(int sample_type);
+
+/* Return the fastest mixing, gain and metering kernels the CPU supports */
+dsp_mix_func        dsp_get_mix(void);
+dsp_gain_func       dsp_get_gain(void);
+dsp_meter_func      dsp_get_meter(void);
+
+/* Name of the instruction set the kernels were selected for */
+const char* dsp_get_isa_name(void);
@@ -67,6 +67,7 @@ typedef void (*jacksym_uuid_unparse)(jack_uuid_t, char buf[JACK_UUID_STRING_SIZE
 typedef int (*jacksym_activate)(jack_client_t*);
 typedef int (*jacksym_deactivate)(jack_client_t*);
 typedef int (*jacksym_is_realtime)(jack_client_t*);
+typedef int (*jacksym_client_real_time_priority)(jack_client_t*);
 
 typedef int  (*jacksym_set_thread_init_callback)(jack_client_t*, JackSymThreadInitCallback, void*);
 typedef void (*jacksym_on_shutdown)(jack_client_t*, JackSymShutdownCallback, void*);
@@ -172,6 +173,10 @@ typedef void           (*jacksym_cycle_signal)(jack_client_t*, int);
 
 typedef jack_nframes_t (*jacksym_port_get_latency)(jack_port_t*);
 typedef jack_nframes_t (*jacksym_frame_time)(const jack_client_t*);
+typedef jack_nframes_t (*jacksym_last_frame_time)(const jack_client_t*);
+typedef int            (*jacksym_get_cycle_times)(const jack_client_t*, jack_nframes_t*, jack_time_t*, jack_time_t*, float*);
+typedef jack_time_t    (*jacksym_frames_to_time)(const jack_client_t*, jack_nframes_t);
+typedef jack_time_t    (*jacksym_get_time)(void);
 
 // --------------------------------------------------------------------------------------------------------------------
 
@@ -197,6 +202,7 @@ typedef struct JackBridge {
     jacksym_activate activate_ptr;
     jacksym_deactivate deactivate_ptr;
     jacksym_is_realtime is_realtime_ptr;
+    jacksym_client_real_time_priority client_real_time_priority_ptr;
 
     jacksym_set_thread_init_callback set_thread_init_callback_ptr;
     jacksym_on_shutdown on_shutdown_ptr;
@@ -301,6 +307,10 @@ typedef struct JackBridge {
 
     jacksym_port_get_latency port_get_latency_ptr;
     jacksym_frame_time frame_time_ptr;
+    jacksym_last_frame_time last_frame_time_ptr;
+    jacksym_get_cycle_times get_cycle_times_ptr;
+    jacksym_frames_to_time frames_to_time_ptr;
+    jacksym_get_time get_time_ptr;
 } JackBridge;
 
 static void jackbridge_init(JackBridge* const bridge)
@@ -341,6 +351,7 @@ static void jackbridge_init(JackBridge* const bridge)
     LIB_SYMBOL(activate)
     LIB_SYMBOL(deactivate)
     LIB_SYMBOL(is_realtime)
+    LIB_SYMBOL(client_real_time_priority)
 
     LIB_SYMBOL(set_thread_init_callback)
     LIB_SYMBOL(on_shutdown)
@@ -443,6 +454,10 @@ static void jackbridge_init(JackBridge* const bridge)
 
     LIB_SYMBOL(port_get_latency)
     LIB_SYMBOL(frame_time)
+    LIB_SYMBOL(last_frame_time)
+    LIB_SYMBOL(get_cycle_times)
+    LIB_SYMBOL(frames_to_time)
+    LIB_SYMBOL(get_time)
 
     #undef JOIN
     #undef LIB_SYMBOL
@@ -597,6 +612,13 @@ bool jackbridge_is_realtime(jack_client_t* client)
     return false;
 }
 
+int jackbridge_client_real_time_priority(jack_client_t* client)
+{
+    if (jackbridge_instance()->client_real_time_priority_ptr != NULL)
+        return jackbridge_instance()->client_real_time_priority_ptr(client);
+    return -1;
+}
+
 // --------------------------------------------------------------------------------------------------------------------
 
 bool jackbridge_set_thread_init_callback(jack_client_t* client, JackThreadInitCallback thread_init_callback, void* arg)
@@ -1203,13 +1225,41 @@ void jackbridge_cycle_signal(jack_client_t* client, int status)
 jack_nframes_t jackbridge_port_get_latency(jack_port_t* port)
 {
     if (jackbridge_instance()->port_get_latency_ptr != NULL)
-        jackbridge_instance()->port_get_latency_ptr(port);
+        return jackbridge_instance()->port_get_latency_ptr(port);
     return 0;
 }
 
 jack_nframes_t jackbridge_frame_time(const jack_client_t* client)
 {
     if (jackbridge_instance()->frame_time_ptr != NULL)
-        jackbridge_instance()->frame_time_ptr(client);
+        return jackbridge_instance()->frame_time_ptr(client);
+    return 0;
+}
+
+jack_nframes_t jackbridge_last_frame_time(const jack_client_t* client)
+{
+    if (jackbridge_instance()->last_frame_time_ptr != NULL)
+        return jackbridge_instance()->last_frame_time_ptr(client);
+    return 0;
+}
+
+bool jackbridge_get_cycle_times(const jack_client_t* client, jack_nframes_t* current_frames, jack_time_t* current_usecs, jack_time_t* next_usecs, float* period_usecs)
+{
+    if (jackbridge_instance()->get_cycle_times_ptr != NULL)
+        return (jackbridge_instance()->get_cycle_times_ptr(client, current_frames, current_usecs, next_usecs, period_usecs) == 0);
+    return false;
+}
+
+jack_time_t jackbridge_frames_to_time(const jack_client_t* client, jack_nframes_t frames)
+{
+    if (jackbridge_instance()->frames_to_time_ptr != NULL)
+        return jackbridge_instance()->frames_to_time_ptr(client, frames);
+    return 0;
+}
+
+jack_time_t jackbridge_get_time()
+{
+    if (jackbridge_instance()->get_time_ptr != NULL)
+        return jackbridge_instance()->get_time_ptr();
     return 0;
 }
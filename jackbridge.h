@@ -250,6 +250,7 @@ void jackbridge_uuid_unparse(jack_uuid_t uuid, char buf[JACK_UUID_STRING_SIZE]);
 bool jackbridge_activate(jack_client_t* client);
 bool jackbridge_deactivate(jack_client_t* client);
 bool jackbridge_is_realtime(jack_client_t* client);
+int  jackbridge_client_real_time_priority(jack_client_t* client);
 
 bool jackbridge_set_thread_init_callback(jack_client_t* client, JackThreadInitCallback thread_init_callback, void* arg);
 void jackbridge_on_shutdown(jack_client_t* client, JackShutdownCallback shutdown_callback, void* arg);
@@ -353,3 +354,7 @@ void jackbridge_cycle_signal(jack_client_t* client, int status);
 
 jack_nframes_t jackbridge_port_get_latency(jack_port_t* port);
 jack_nframes_t jackbridge_frame_time(const jack_client_t* client);
+jack_nframes_t jackbridge_last_frame_time(const jack_client_t* client);
+bool           jackbridge_get_cycle_times(const jack_client_t* client, jack_nframes_t* current_frames, jack_time_t* current_usecs, jack_time_t* next_usecs, float* period_usecs);
+jack_time_t    jackbridge_frames_to_time(const jack_client_t* client, jack_nframes_t frames);
+jack_time_t    jackbridge_get_time();
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2026 WineASIO contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/* Live performance metrics, published in the POSIX shared memory segment "/wineasio-<JACK client name>"
+ * (slashes in the client name replaced by underscores) for as long as the driver is initialized.
+ *
+ * Every field has a single writer, which updates it with a relaxed atomic store, so readers never block
+ * the driver but may see fields from different cycles. The layout is the same for 32 and 64 bit builds,
+ * readers should check version and size before anything else. */
+
+#define WINEASIO_METRICS_VERSION    1
+#define WINEASIO_METRICS_BUCKETS    16  /* host callback durations, in eighths of the host buffer period */
+
+typedef struct WineASIOMetrics
+{
+    uint32_t    version;
+    uint32_t    size;
+    uint32_t    sample_rate;
+    uint32_t    host_buffer_size;   /* frames, the time budget of one host callback */
+
+    uint64_t    cycles;             /* JACK process cycles */
+    uint64_t    xruns;              /* reported by JACK */
+    float       dsp_load;           /* percent, as reported by JACK */
+
+    /* the whole JACK process callback */
+    uint32_t    process_last_usecs;
+    uint32_t    process_max_usecs;
+
+    /* from the start of the JACK cycle to the host callback, and the host callback itself */
+    uint32_t    wakeup_last_usecs;
+    uint32_t    wakeup_max_usecs;
+    uint32_t    swap_last_usecs;
+    uint32_t    swap_max_usecs;
+    uint32_t    reserved;
+
+    /* host callbacks, counted by duration, the last bucket also counts all longer ones */
+    uint64_t    swaps;
+    uint64_t    swap_histogram[WINEASIO_METRICS_BUCKETS];
+} WineASIOMetrics;
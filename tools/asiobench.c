@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2026 WineASIO contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* Headless benchmark of the driver's process callback.
+ * Runs under Wine with the stand-in libjack.so.0 from fakejack.c first in LD_LIBRARY_PATH,
+ * goes through Init, CreateBuffers and Start like a host would, then lets fakejack_run()
+ * call the process callback back to back and reports what one cycle costs. */
+
+#include <dlfcn.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "asiohost.h"
+#include "fakejack.h"
+
+static BufferInformation    *buffers;
+static LONG                 num_inputs, num_outputs, buffer_size;
+
+/* a host that passes its inputs through, so the buffers get touched like in a real session */
+static void ASIO_CALLBACK bench_swap_buffers(LONG index, LONG direct)
+{
+    LONG i;
+
+    for (i = 0; i < num_inputs && i < num_outputs; i++)
+        memcpy(index ? buffers[num_inputs + i].audioBufferEnd : buffers[num_inputs + i].audioBufferStart,
+               index ? buffers[i].audioBufferEnd : buffers[i].audioBufferStart, buffer_size * sizeof(float));
+}
+
+static void* ASIO_CALLBACK bench_swap_buffers_with_time_info(TimeInformation *time, LONG index, LONG direct)
+{
+    bench_swap_buffers(index, direct);
+    return time;
+}
+
+static void ASIO_CALLBACK bench_sample_rate_changed(double rate)
+{
+}
+
+static LONG ASIO_CALLBACK bench_send_notification(LONG selector, LONG value, void *message, double *opt)
+{
+    /* supports the time info callback, nothing else */
+    return selector == 1 ? value == 7 : selector == 7;
+}
+
+static Callbacks bench_callbacks = {
+    bench_swap_buffers,
+    bench_sample_rate_changed,
+    bench_send_notification,
+    bench_swap_buffers_with_time_info
+};
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: asiobench [-d driver.dll] [-i inputs] [-o outputs] [-n frames] [-r rate] [-c cycles]\n");
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    const char              *dll = ASIOHOST_DEFAULT_DLL, *inputs = "16", *outputs = "16";
+    fakejack_configure_func fakejack_configure;
+    fakejack_run_func       fakejack_run;
+    FakeJackStats           stats;
+    uint64_t                cycles = 100000;
+    uint32_t                frames = 256, rate = 48000;
+    double                  nsecs_per_cycle;
+    IASIO                   *driver;
+    void                    *fakejack;
+    LONG                    i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (i + 1 == argc || argv[i][0] != '-')
+            usage();
+        switch (argv[i++][1])
+        {
+            case 'd': dll = argv[i]; break;
+            case 'i': inputs = argv[i]; break;
+            case 'o': outputs = argv[i]; break;
+            case 'n': frames = atoi(argv[i]); break;
+            case 'r': rate = atoi(argv[i]); break;
+            case 'c': cycles = strtoull(argv[i], NULL, 10); break;
+            default: usage();
+        }
+    }
+
+    /* the same library the driver will dlopen, which has to be the stand-in */
+    fakejack = dlopen("libjack.so.0", RTLD_NOW);
+    fakejack_configure = fakejack ? (fakejack_configure_func) dlsym(fakejack, "fakejack_configure") : NULL;
+    fakejack_run = fakejack ? (fakejack_run_func) dlsym(fakejack, "fakejack_run") : NULL;
+    if (!fakejack_configure || !fakejack_run)
+    {
+        fprintf(stderr, "libjack.so.0 is not the stand-in from fakejack.c, check LD_LIBRARY_PATH\n");
+        return 1;
+    }
+    fakejack_configure(frames, rate);
+
+    /* the driver takes its channel counts from the environment, and must not wait for the JACK period */
+    SetEnvironmentVariableA("WINEASIO_NUMBER_INPUTS", inputs);
+    SetEnvironmentVariableA("WINEASIO_NUMBER_OUTPUTS", outputs);
+    SetEnvironmentVariableA("WINEASIO_FIXED_BUFFERSIZE", "on");
+
+    if (!(driver = asiohost_load(dll)))
+        return 1;
+    if (!driver->lpVtbl->Init(driver, NULL))
+    {
+        fprintf(stderr, "Init failed\n");
+        return 1;
+    }
+
+    driver->lpVtbl->GetChannels(driver, &num_inputs, &num_outputs);
+    buffer_size = frames;
+    buffers = calloc(num_inputs + num_outputs, sizeof(*buffers));
+    for (i = 0; i < num_inputs + num_outputs; i++)
+    {
+        buffers[i].isInputType = i < num_inputs;
+        buffers[i].channelNumber = i < num_inputs ? i : i - num_inputs;
+    }
+    if (driver->lpVtbl->CreateBuffers(driver, buffers, num_inputs + num_outputs, buffer_size, &bench_callbacks)
+            || driver->lpVtbl->Start(driver))
+    {
+        fprintf(stderr, "CreateBuffers or Start failed\n");
+        return 1;
+    }
+
+    /* warm up the caches and the branch predictors first */
+    fakejack_run(cycles / 10 + 1, &stats);
+    fakejack_run(cycles, &stats);
+
+    nsecs_per_cycle = (double) stats.nsecs / stats.cycles;
+    printf("%d inputs, %d outputs, %u frames at %u Hz, %llu cycles\n", (int) num_inputs, (int) num_outputs, frames, rate,
+           (unsigned long long) stats.cycles);
+    printf("%12.1f ns per cycle\n", nsecs_per_cycle);
+    printf("%12.0f cycles per second\n", 1e9 / nsecs_per_cycle);
+    printf("%12.4f %% of the period budget\n", 100.0 * nsecs_per_cycle * rate / (frames * 1e9));
+    if (stats.perf)
+    {
+        printf("%12.1f cpu cycles per cycle\n", (double) stats.cpu_cycles / stats.cycles);
+        printf("%12.1f instructions per cycle\n", (double) stats.instructions / stats.cycles);
+        printf("%12.2f cache misses per cycle\n", (double) stats.cache_misses / stats.cycles);
+    }
+    else
+    {
+        printf("perf_event is not available, no hardware counters\n");
+    }
+
+    driver->lpVtbl->Stop(driver);
+    driver->lpVtbl->DisposeBuffers(driver);
+    driver->lpVtbl->Release(driver);
+    free(buffers);
+    return 0;
+}
@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2026 WineASIO contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#pragma once
+
+/* Minimal ASIO host side of the driver interface, shared by the tools.
+ * The structures mirror the ones in asio.c, the driver is loaded straight from its DLL
+ * through DllGetClassObject(), so it does not need to be registered. */
+
+#include <stdio.h>
+#include <windows.h>
+#include <objbase.h>
+
+/* the driver methods use the Microsoft thiscall convention on 32 bit, see asio.c */
+#ifdef __i386__
+#define ASIO_METHOD __attribute__((thiscall))
+#else
+#define ASIO_METHOD STDMETHODCALLTYPE
+#endif
+
+#ifdef _WIN64
+#define ASIO_CALLBACK CALLBACK
+#else
+#define ASIO_CALLBACK
+#endif
+
+#define ASIO_OK                 0
+#define ASIO_SUCCESS            0x3f4847a0
+#define ASIO_NOT_PRESENT        -1000
+#define ASIO_INVALID_PARAMETER  -998
+#define ASIO_INVALID_MODE       -997
+#define ASIO_NO_CLOCK           -995
+
+typedef struct w_int64_t {
+    ULONG hi;
+    ULONG lo;
+} w_int64_t;
+
+static inline double asio_int64(const w_int64_t *value)
+{
+    return value->hi * 4294967296.0 + value->lo;
+}
+
+typedef struct BufferInformation
+{
+    LONG isInputType;
+    LONG channelNumber;
+    void *audioBufferStart;
+    void *audioBufferEnd;
+} BufferInformation;
+
+typedef struct TimeInformation
+{
+    LONG      _1[4];
+    double    speed;
+    w_int64_t timeStamp;
+    w_int64_t numSamples;
+    double    sampleRate;
+    ULONG     flags;
+    char      _3[12];
+    double    speedForTimeCode;
+    w_int64_t samplesForTimeCode;
+    ULONG     flagsForTimeCode;
+    char      _4[64];
+} TimeInformation;
+
+typedef struct ChannelInformation
+{
+    LONG channel;
+    LONG isInput;
+    LONG isActive;
+    LONG channelGroup;
+    LONG sampleType;
+    char name[32];
+} ChannelInformation;
+
+typedef struct ClockSource
+{
+    LONG index;
+    LONG associatedChannel;
+    LONG associatedGroup;
+    LONG isCurrentSource;
+    char name[32];
+} ClockSource;
+
+typedef struct ChannelControls
+{
+    LONG channel;
+    LONG isInput;
+    LONG gain;
+    LONG meter;
+    char future[32];
+} ChannelControls;
+
+typedef struct Callbacks
+{
+    void (ASIO_CALLBACK *swapBuffers) (LONG, LONG);
+    void (ASIO_CALLBACK *sampleRateChanged) (double);
+    LONG (ASIO_CALLBACK *sendNotification) (LONG, LONG, void*, double*);
+    void* (ASIO_CALLBACK *swapBuffersWithTimeInfo) (TimeInformation*, LONG, LONG);
+} Callbacks;
+
+typedef struct IASIO IASIO;
+
+typedef struct IASIOVtbl
+{
+    HRESULT (STDMETHODCALLTYPE *QueryInterface) (IASIO *This, REFIID riid, void **object);
+    ULONG (STDMETHODCALLTYPE *AddRef) (IASIO *This);
+    ULONG (STDMETHODCALLTYPE *Release) (IASIO *This);
+    LONG (ASIO_METHOD *Init) (IASIO *This, void *sysRef);
+    void (ASIO_METHOD *GetDriverName) (IASIO *This, char *name);
+    LONG (ASIO_METHOD *GetDriverVersion) (IASIO *This);
+    void (ASIO_METHOD *GetErrorMessage) (IASIO *This, char *string);
+    LONG (ASIO_METHOD *Start) (IASIO *This);
+    LONG (ASIO_METHOD *Stop) (IASIO *This);
+    LONG (ASIO_METHOD *GetChannels) (IASIO *This, LONG *numInputChannels, LONG *numOutputChannels);
+    LONG (ASIO_METHOD *GetLatencies) (IASIO *This, LONG *inputLatency, LONG *outputLatency);
+    LONG (ASIO_METHOD *GetBufferSize) (IASIO *This, LONG *minSize, LONG *maxSize, LONG *preferredSize, LONG *granularity);
+    LONG (ASIO_METHOD *CanSampleRate) (IASIO *This, double sampleRate);
+    LONG (ASIO_METHOD *GetSampleRate) (IASIO *This, double *sampleRate);
+    LONG (ASIO_METHOD *SetSampleRate) (IASIO *This, double sampleRate);
+    LONG (ASIO_METHOD *GetClockSources) (IASIO *This, ClockSource *clocks, LONG *numSources);
+    LONG (ASIO_METHOD *SetClockSource) (IASIO *This, LONG index);
+    LONG (ASIO_METHOD *GetSamplePosition) (IASIO *This, w_int64_t *sPos, w_int64_t *tStamp);
+    LONG (ASIO_METHOD *GetChannelInfo) (IASIO *This, ChannelInformation *info);
+    LONG (ASIO_METHOD *CreateBuffers) (IASIO *This, BufferInformation *bufferInfo, LONG numChannels, LONG bufferSize, Callbacks *callbacks);
+    LONG (ASIO_METHOD *DisposeBuffers) (IASIO *This);
+    LONG (ASIO_METHOD *ControlPanel) (IASIO *This);
+    LONG (ASIO_METHOD *Future) (IASIO *This, LONG selector, void *opt);
+    LONG (ASIO_METHOD *OutputReady) (IASIO *This);
+} IASIOVtbl;
+
+struct IASIO
+{
+    const IASIOVtbl *lpVtbl;
+};
+
+/* {48D0C522-BFCC-45cc-8B84-17F25F33E6E8} */
+static GUID const CLSID_WineASIO = {
+0x48d0c522, 0xbfcc, 0x45cc, { 0x8b, 0x84, 0x17, 0xf2, 0x5f, 0x33, 0xe6, 0xe8 } };
+
+/* Loads the driver from its DLL, hosts pass the CLSID as the interface id */
+static inline IASIO *asiohost_load(const char *dll)
+{
+    HRESULT (WINAPI *get_class_object)(REFCLSID, REFIID, void **);
+    IClassFactory   *factory;
+    IASIO           *driver = NULL;
+    HMODULE         module;
+
+    if (!(module = LoadLibraryA(dll)))
+    {
+        fprintf(stderr, "Unable to load %s\n", dll);
+        return NULL;
+    }
+    get_class_object = (void *) GetProcAddress(module, "DllGetClassObject");
+    if (!get_class_object || FAILED(get_class_object(&CLSID_WineASIO, &IID_IClassFactory, (void **) &factory)))
+    {
+        fprintf(stderr, "%s has no WineASIO class object\n", dll);
+        return NULL;
+    }
+    if (FAILED(factory->lpVtbl->CreateInstance(factory, NULL, &CLSID_WineASIO, (void **) &driver)))
+        fprintf(stderr, "Unable to create the WineASIO driver\n");
+    factory->lpVtbl->Release(factory);
+    return driver;
+}
+
+#ifdef _WIN64
+#define ASIOHOST_DEFAULT_DLL "wineasio64.dll"
+#else
+#define ASIOHOST_DEFAULT_DLL "wineasio32.dll"
+#endif
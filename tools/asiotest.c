@@ -0,0 +1,396 @@
+/*
+ * Copyright (C) 2026 WineASIO contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* Conformance and timing test of the driver against a running JACK server, usually 'jackd -d dummy'.
+ * Calls every IWineASIO method in host order and checks the results, then runs a timed session and
+ * reports the jitter of the callback intervals, the largest callback lateness and the drift of
+ * GetSamplePosition() against the wall clock. After the session, a JACK buffer size change is made
+ * through a client of our own, to check the driver notifies the host. Exits with 1 if any check failed. */
+
+#include <dlfcn.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "asiohost.h"
+
+#define MAX_CALLBACKS   (1 << 20)
+#define MAX_POSITIONS   4096
+
+static int                  checks_failed, checks_passed;
+
+static BufferInformation    *buffers;
+static LONG                 num_inputs, num_outputs, buffer_size;
+static double               sample_rate;
+
+/* written by the callbacks, read once the driver is stopped */
+static LONGLONG             *callback_times;
+static volatile LONG        callback_count, session_over;
+static LONG                 callback_position_errors, callback_time_errors;
+static double               callback_last_position = -1, callback_last_time;
+static volatile LONG        notified_reset, notified_buffer_size, notified_latencies, notified_resync;
+static volatile LONG        sample_rate_changes;
+
+static void check(int condition, const char *format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    printf(condition ? "  ok    " : "  FAIL  ");
+    vprintf(format, args);
+    printf("\n");
+    va_end(args);
+    if (condition)
+        checks_passed++;
+    else
+        checks_failed++;
+}
+
+static LONGLONG performance_counter(void)
+{
+    LARGE_INTEGER counter;
+
+    QueryPerformanceCounter(&counter);
+    return counter.QuadPart;
+}
+
+static void ASIO_CALLBACK test_swap_buffers(LONG index, LONG direct)
+{
+    const LONG count = callback_count;
+
+    if (count < MAX_CALLBACKS && !session_over)
+    {
+        callback_times[count] = performance_counter();
+        callback_count = count + 1;
+    }
+}
+
+/* besides the timing, the time info has to advance by one buffer per callback with a rising timestamp */
+static void* ASIO_CALLBACK test_swap_buffers_with_time_info(TimeInformation *time, LONG index, LONG direct)
+{
+    const double position = asio_int64(&time->numSamples), stamp = asio_int64(&time->timeStamp);
+
+    if (callback_last_position >= 0 && !session_over)
+    {
+        if (position != callback_last_position + buffer_size)
+            callback_position_errors++;
+        if (stamp <= callback_last_time)
+            callback_time_errors++;
+    }
+    callback_last_position = position;
+    callback_last_time = stamp;
+    test_swap_buffers(index, direct);
+    return time;
+}
+
+static void ASIO_CALLBACK test_sample_rate_changed(double rate)
+{
+    sample_rate_changes++;
+}
+
+static LONG ASIO_CALLBACK test_send_notification(LONG selector, LONG value, void *message, double *opt)
+{
+    switch (selector)
+    {
+        case 1: /* selector supported */
+            return value >= 1 && value <= 7;
+        case 2: /* engine version */
+            return 2;
+        case 3:
+            notified_reset++;
+            return 1;
+        case 4:
+            notified_buffer_size++;
+            return 1;
+        case 5:
+            notified_resync++;
+            return 1;
+        case 6:
+            notified_latencies++;
+            return 1;
+        case 7: /* supports time info */
+            return 1;
+    }
+    return 0;
+}
+
+static Callbacks test_callbacks = {
+    test_swap_buffers,
+    test_sample_rate_changed,
+    test_send_notification,
+    test_swap_buffers_with_time_info
+};
+
+/* Changes the JACK period through a client of our own, returns the period it had before or 0 */
+static unsigned int change_jack_buffer_size(unsigned int frames)
+{
+    void            *(*client_open)(const char *, int, int *, ...);
+    int             (*client_close)(void *);
+    int             (*set_buffer_size)(void *, uint32_t);
+    uint32_t        (*get_buffer_size)(void *);
+    void            *libjack, *client;
+    unsigned int    previous = 0;
+    int             status;
+
+    if (!(libjack = dlopen("libjack.so.0", RTLD_NOW)))
+        return 0;
+    client_open = dlsym(libjack, "jack_client_open");
+    client_close = dlsym(libjack, "jack_client_close");
+    set_buffer_size = dlsym(libjack, "jack_set_buffer_size");
+    get_buffer_size = dlsym(libjack, "jack_get_buffer_size");
+    if (client_open && client_close && set_buffer_size && get_buffer_size
+            && (client = client_open("asiotest-control", 1 /* JackNoStartServer */, &status)))
+    {
+        previous = get_buffer_size(client);
+        if (set_buffer_size(client, frames))
+            previous = 0;
+        client_close(client);
+    }
+    dlclose(libjack);
+    return previous;
+}
+
+/* Reports the callback interval jitter and how late the latest callback came, against a straight line
+ * through the callback times so that clock drift between JACK and the performance counter is left out */
+static void report_timing(double frequency)
+{
+    const double    period = buffer_size / sample_rate;
+    double          mean, variance = 0, deviation, max_deviation = 0, lateness, min_offset = 1e300, max_offset = -1e300;
+    LONG            i, count = callback_count;
+
+    if (count < 3)
+    {
+        check(0, "at least 3 callbacks during the session, got %d", (int)count);
+        return;
+    }
+    mean = (callback_times[count - 1] - callback_times[0]) / frequency / (count - 1);
+    for (i = 1; i < count; i++)
+    {
+        deviation = (callback_times[i] - callback_times[i - 1]) / frequency - mean;
+        variance += deviation * deviation;
+        if (fabs(deviation) > max_deviation)
+            max_deviation = fabs(deviation);
+    }
+    for (i = 0; i < count; i++)
+    {
+        lateness = (callback_times[i] - callback_times[0]) / frequency - i * mean;
+        if (lateness < min_offset)
+            min_offset = lateness;
+        if (lateness > max_offset)
+            max_offset = lateness;
+    }
+
+    printf("\n%d callbacks, period %.3f ms (nominal %.3f ms)\n", (int)count, mean * 1e3, period * 1e3);
+    printf("  interval jitter     %10.1f us rms, %.1f us max\n", sqrt(variance / (count - 1)) * 1e6, max_deviation * 1e6);
+    printf("  callback lateness   %10.1f us max\n", (max_offset - min_offset) * 1e6);
+    check(fabs(mean - period) < period * 0.01, "mean callback interval within 1%% of the period");
+    check(!callback_position_errors, "time info sample position advanced by the buffer size (%d errors)", (int)callback_position_errors);
+    check(!callback_time_errors, "time info timestamps rising (%d errors)", (int)callback_time_errors);
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: asiotest [-d driver.dll] [-s seconds] [-n frames] [-b frames] [-p]\n"
+                    "  -n  host buffer size, default the preferred one\n"
+                    "  -b  JACK period to switch to after the session, default half the current one, 0 to skip\n"
+                    "  -p  also open the control panel\n");
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    const char          *dll = ASIOHOST_DEFAULT_DLL;
+    LARGE_INTEGER       frequency;
+    ClockSource         clocks[4];
+    ChannelInformation  info;
+    ChannelControls     controls;
+    w_int64_t           position, stamp;
+    double              rate, positions[MAX_POSITIONS], position_times[MAX_POSITIONS], wall, drift;
+    char                text[256];
+    int                 seconds = 10, control_panel = 0, num_positions = 0, step;
+    LONG                min_size, max_size, preferred_size, granularity, input_latency, output_latency;
+    LONG                num_clocks, result, i, requested_size = 0, jack_size = -1;
+    unsigned int        previous_jack_size = 0;
+    IASIO               *driver;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-p"))
+        {
+            control_panel = 1;
+            continue;
+        }
+        if (i + 1 == argc || argv[i][0] != '-')
+            usage();
+        switch (argv[i++][1])
+        {
+            case 'd': dll = argv[i]; break;
+            case 's': seconds = atoi(argv[i]); break;
+            case 'n': requested_size = atoi(argv[i]); break;
+            case 'b': jack_size = atoi(argv[i]); break;
+            default: usage();
+        }
+    }
+    QueryPerformanceFrequency(&frequency);
+    callback_times = calloc(MAX_CALLBACKS, sizeof(*callback_times));
+
+    if (!(driver = asiohost_load(dll)))
+        return 1;
+
+    printf("Driver information\n");
+    check(driver->lpVtbl->Init(driver, NULL) == 1, "Init");
+    driver->lpVtbl->GetDriverName(driver, text);
+    check(text[0] != 0, "GetDriverName: %s", text);
+    check(driver->lpVtbl->GetDriverVersion(driver) > 0, "GetDriverVersion: %d", (int)driver->lpVtbl->GetDriverVersion(driver));
+    text[0] = 0;
+    driver->lpVtbl->GetErrorMessage(driver, text);
+    check(text[0] != 0, "GetErrorMessage");
+
+    check(!driver->lpVtbl->GetChannels(driver, &num_inputs, &num_outputs) && num_inputs > 0 && num_outputs > 0,
+          "GetChannels: %d inputs, %d outputs", (int)num_inputs, (int)num_outputs);
+    result = driver->lpVtbl->GetBufferSize(driver, &min_size, &max_size, &preferred_size, &granularity);
+    check(!result && min_size > 0 && min_size <= preferred_size && preferred_size <= max_size,
+          "GetBufferSize: min %d, max %d, preferred %d, granularity %d", (int)min_size, (int)max_size, (int)preferred_size, (int)granularity);
+    check(!driver->lpVtbl->GetSampleRate(driver, &sample_rate) && sample_rate > 0, "GetSampleRate: %.0f", sample_rate);
+    check(!driver->lpVtbl->CanSampleRate(driver, sample_rate), "CanSampleRate of the current rate");
+    rate = sample_rate == 44100 ? 48000 : 44100;
+    check(driver->lpVtbl->CanSampleRate(driver, rate) == ASIO_NO_CLOCK, "CanSampleRate of another rate is refused");
+    check(!driver->lpVtbl->SetSampleRate(driver, sample_rate), "SetSampleRate to the current rate");
+    check(driver->lpVtbl->SetSampleRate(driver, rate) == ASIO_NO_CLOCK, "SetSampleRate to another rate is refused");
+
+    num_clocks = sizeof(clocks) / sizeof(clocks[0]);
+    result = driver->lpVtbl->GetClockSources(driver, clocks, &num_clocks);
+    check(!result && num_clocks >= 1 && clocks[0].isCurrentSource, "GetClockSources: %d, current '%s'", (int)num_clocks, clocks[0].name);
+    check(!driver->lpVtbl->SetClockSource(driver, 0), "SetClockSource 0");
+
+    for (i = 0, result = 0; i < num_inputs + num_outputs; i++)
+    {
+        memset(&info, 0, sizeof(info));
+        info.isInput = i < num_inputs;
+        info.channel = i < num_inputs ? i : i - num_inputs;
+        if (driver->lpVtbl->GetChannelInfo(driver, &info) || !info.name[0] || info.isActive)
+            result++;
+    }
+    check(!result, "GetChannelInfo of every channel, all inactive before CreateBuffers");
+    info.isInput = 1;
+    info.channel = num_inputs;
+    check(driver->lpVtbl->GetChannelInfo(driver, &info) == ASIO_INVALID_PARAMETER, "GetChannelInfo of a channel out of range is refused");
+    check(driver->lpVtbl->Start(driver) == ASIO_NOT_PRESENT, "Start before CreateBuffers is refused");
+
+    printf("\nBuffers\n");
+    buffer_size = requested_size ? requested_size : preferred_size;
+    buffers = calloc(num_inputs + num_outputs, sizeof(*buffers));
+    for (i = 0; i < num_inputs + num_outputs; i++)
+    {
+        buffers[i].isInputType = i < num_inputs;
+        buffers[i].channelNumber = i < num_inputs ? i : i - num_inputs;
+    }
+    check(!driver->lpVtbl->CreateBuffers(driver, buffers, num_inputs + num_outputs, buffer_size, &test_callbacks),
+          "CreateBuffers: %d channels of %d frames", (int)(num_inputs + num_outputs), (int)buffer_size);
+    for (i = 0, result = 0; i < num_inputs + num_outputs; i++)
+        if (!buffers[i].audioBufferStart || !buffers[i].audioBufferEnd)
+            result++;
+    check(!result, "CreateBuffers filled in both buffer halves of every channel");
+    check(!driver->lpVtbl->GetLatencies(driver, &input_latency, &output_latency) && input_latency >= 0 && output_latency >= buffer_size,
+          "GetLatencies: input %d, output %d", (int)input_latency, (int)output_latency);
+    info.isInput = 1;
+    info.channel = 0;
+    check(!driver->lpVtbl->GetChannelInfo(driver, &info) && info.isActive, "GetChannelInfo reports the channels active");
+
+    printf("\nFuture selectors\n");
+    for (i = 9; i <= 16; i++)
+    {
+        result = driver->lpVtbl->Future(driver, i, NULL);
+        check(result == ASIO_SUCCESS || result == ASIO_INVALID_PARAMETER, "Future %d: %s", (int)i,
+              result == ASIO_SUCCESS ? "supported" : "not supported");
+    }
+    memset(&controls, 0, sizeof(controls));
+    controls.channel = num_inputs;
+    result = driver->lpVtbl->Future(driver, 5, &controls);
+    check(result == ASIO_INVALID_PARAMETER, "Future 5 (set input gain) of a channel out of range is refused");
+    check(driver->lpVtbl->Future(driver, 0x7fffffff, NULL) != ASIO_SUCCESS, "unknown Future selector is refused");
+
+    printf("\nSession of %d seconds\n", seconds);
+    check(!driver->lpVtbl->Start(driver), "Start");
+    result = driver->lpVtbl->OutputReady(driver);
+    check(result == ASIO_OK || result == ASIO_NOT_PRESENT, "OutputReady: %s", result ? "not supported" : "supported");
+
+    step = seconds * 1000 / MAX_POSITIONS + 1 > 20 ? seconds * 1000 / MAX_POSITIONS + 1 : 20;
+    for (i = 0; i < seconds * 1000 / step && num_positions < MAX_POSITIONS; i++)
+    {
+        Sleep(step);
+        if (!driver->lpVtbl->GetSamplePosition(driver, &position, &stamp))
+        {
+            positions[num_positions] = asio_int64(&position);
+            position_times[num_positions++] = (double) performance_counter() / frequency.QuadPart;
+        }
+    }
+    session_over = 1;
+
+    /* change the JACK period and back while running, the driver has to tell the host */
+    if (jack_size)
+    {
+        previous_jack_size = change_jack_buffer_size(jack_size > 0 ? jack_size : buffer_size / 2);
+        if (previous_jack_size)
+        {
+            Sleep(500);
+            change_jack_buffer_size(previous_jack_size);
+            Sleep(500);
+        }
+    }
+    check(!driver->lpVtbl->Stop(driver), "Stop");
+    check(driver->lpVtbl->Stop(driver) == ASIO_NOT_PRESENT, "Stop while stopped is refused");
+
+    report_timing(frequency.QuadPart);
+
+    if (num_positions > 1)
+    {
+        wall = position_times[num_positions - 1] - position_times[0];
+        drift = ((positions[num_positions - 1] - positions[0]) / sample_rate - wall) / wall;
+        printf("  sample position     %10.1f ppm drift against the wall clock over %.1f s\n", drift * 1e6, wall);
+        check(fabs(drift) < 0.001, "GetSamplePosition follows the wall clock within 1000 ppm");
+    }
+    else
+    {
+        check(0, "GetSamplePosition during the session");
+    }
+
+    printf("\nNotifications\n");
+    if (!jack_size)
+        printf("  skipped the JACK buffer size change\n");
+    else if (!previous_jack_size)
+        printf("  unable to change the JACK buffer size, is a JACK server running?\n");
+    else
+        check(notified_reset || notified_buffer_size || notified_latencies,
+              "JACK buffer size change notified: %d resets, %d buffer size changes, %d latency changes",
+              (int)notified_reset, (int)notified_buffer_size, (int)notified_latencies);
+    check(!sample_rate_changes, "no sample rate change reported while the JACK rate stayed the same");
+
+    printf("\nShutdown\n");
+    check(!driver->lpVtbl->DisposeBuffers(driver), "DisposeBuffers");
+    check(driver->lpVtbl->DisposeBuffers(driver) == ASIO_NOT_PRESENT, "DisposeBuffers without buffers is refused");
+    if (control_panel)
+        check(!driver->lpVtbl->ControlPanel(driver), "ControlPanel");
+    driver->lpVtbl->Release(driver);
+
+    printf("\n%d checks passed, %d failed\n", checks_passed, checks_failed);
+    free(buffers);
+    free(callback_times);
+    return checks_failed ? 1 : 0;
+}
@@ -0,0 +1,378 @@
+/*
+ * Copyright (C) 2026 WineASIO contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* Stand-in libjack.so.0 implementing just what WineASIO uses, without a server.
+ * jackbridge dlopens libjack.so.0, so putting this first in LD_LIBRARY_PATH replaces JACK.
+ * Nothing runs on its own, fakejack_run() calls the process callback in a tight loop,
+ * which makes the cost of the driver's RT path measurable without scheduling noise.
+ * Functions the driver can live without are left out, jackbridge then uses its fallbacks. */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "../jackbridge.h"
+#include "fakejack.h"
+
+#define EXPORT __attribute__((visibility("default")))
+#define FAKEJACK_MAX_PORTS      1024
+#define FAKEJACK_MAX_FRAMES     8192
+
+struct _jack_port
+{
+    char            name[160];
+    unsigned long   flags;
+    float           buffer[FAKEJACK_MAX_FRAMES];
+};
+
+struct _jack_client
+{
+    char                    name[64];
+    JackProcessCallback     process;
+    void                    *process_arg;
+    int                     active;
+    jack_nframes_t          frames;
+    jack_time_t             cycle_usecs;
+};
+
+static uint32_t         fake_buffer_size = 256;
+static uint32_t         fake_sample_rate = 48000;
+static jack_client_t    fake_client;
+static jack_port_t      *fake_ports[FAKEJACK_MAX_PORTS];
+
+EXPORT void fakejack_configure(uint32_t buffer_size, uint32_t sample_rate)
+{
+    if (buffer_size > 0 && buffer_size <= FAKEJACK_MAX_FRAMES)
+        fake_buffer_size = buffer_size;
+    if (sample_rate > 0)
+        fake_sample_rate = sample_rate;
+}
+
+static int open_counter(uint32_t type, uint64_t config)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static uint64_t read_counter(int fd)
+{
+    uint64_t value = 0;
+
+    if (read(fd, &value, sizeof(value)) != sizeof(value))
+        return 0;
+    return value;
+}
+
+static uint64_t monotonic_nsecs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+EXPORT int fakejack_run(uint64_t cycles, FakeJackStats *stats)
+{
+    int         counters[3];
+    uint64_t    start, i;
+    int         c;
+
+    if (!fake_client.active || !fake_client.process)
+        return -1;
+
+    memset(stats, 0, sizeof(*stats));
+    counters[0] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    counters[1] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    counters[2] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    stats->perf = counters[0] >= 0 && counters[1] >= 0 && counters[2] >= 0;
+    for (c = 0; c < 3; c++)
+        if (counters[c] >= 0)
+            ioctl(counters[c], PERF_EVENT_IOC_ENABLE, 0);
+
+    start = monotonic_nsecs();
+    for (i = 0; i < cycles; i++)
+    {
+        fake_client.cycle_usecs = monotonic_nsecs() / 1000;
+        fake_client.process(fake_buffer_size, fake_client.process_arg);
+        fake_client.frames += fake_buffer_size;
+    }
+    stats->nsecs = monotonic_nsecs() - start;
+    stats->cycles = cycles;
+
+    for (c = 0; c < 3; c++)
+        if (counters[c] >= 0)
+            ioctl(counters[c], PERF_EVENT_IOC_DISABLE, 0);
+    if (stats->perf)
+    {
+        stats->cpu_cycles = read_counter(counters[0]);
+        stats->instructions = read_counter(counters[1]);
+        stats->cache_misses = read_counter(counters[2]);
+    }
+    for (c = 0; c < 3; c++)
+        if (counters[c] >= 0)
+            close(counters[c]);
+    return 0;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// client
+
+EXPORT jack_client_t* jack_client_open(const char* client_name, jack_options_t options, jack_status_t* status, ...)
+{
+    memset(&fake_client, 0, sizeof(fake_client));
+    snprintf(fake_client.name, sizeof(fake_client.name), "%s", client_name);
+    if (status)
+        *status = 0;
+    return &fake_client;
+}
+
+EXPORT int jack_client_close(jack_client_t* client)
+{
+    client->active = 0;
+    return 0;
+}
+
+EXPORT char* jack_get_client_name(jack_client_t* client)
+{
+    return client->name;
+}
+
+EXPORT int jack_activate(jack_client_t* client)
+{
+    client->active = 1;
+    return 0;
+}
+
+EXPORT int jack_deactivate(jack_client_t* client)
+{
+    client->active = 0;
+    return 0;
+}
+
+EXPORT int jack_is_realtime(jack_client_t* client)
+{
+    return 0;
+}
+
+EXPORT jack_nframes_t jack_get_sample_rate(jack_client_t* client)
+{
+    return fake_sample_rate;
+}
+
+EXPORT jack_nframes_t jack_get_buffer_size(jack_client_t* client)
+{
+    return fake_buffer_size;
+}
+
+EXPORT float jack_cpu_load(jack_client_t* client)
+{
+    return 0.0f;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// callbacks, only the process callback is ever called
+
+EXPORT int jack_set_process_callback(jack_client_t* client, JackProcessCallback callback, void* arg)
+{
+    client->process = callback;
+    client->process_arg = arg;
+    return 0;
+}
+
+EXPORT int jack_set_buffer_size_callback(jack_client_t* client, JackBufferSizeCallback callback, void* arg)
+{
+    return 0;
+}
+
+EXPORT int jack_set_sample_rate_callback(jack_client_t* client, JackSampleRateCallback callback, void* arg)
+{
+    return 0;
+}
+
+EXPORT int jack_set_latency_callback(jack_client_t* client, JackLatencyCallback callback, void* arg)
+{
+    return 0;
+}
+
+EXPORT int jack_set_xrun_callback(jack_client_t* client, JackXRunCallback callback, void* arg)
+{
+    return 0;
+}
+
+EXPORT int jack_set_sync_callback(jack_client_t* client, JackSyncCallback callback, void* arg)
+{
+    return 0;
+}
+
+/* failing here makes the driver treat every port as connected, so no channel gets skipped */
+EXPORT int jack_set_port_connect_callback(jack_client_t* client, JackPortConnectCallback callback, void* arg)
+{
+    return -1;
+}
+
+EXPORT void jack_set_thread_creator(JackThreadCreator creator)
+{
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// ports
+
+EXPORT jack_port_t* jack_port_register(jack_client_t* client, const char* port_name, const char* port_type,
+                                       unsigned long flags, unsigned long buffer_size)
+{
+    jack_port_t *port;
+    int         i;
+
+    for (i = 0; i < FAKEJACK_MAX_PORTS && fake_ports[i]; i++)
+        ;
+    if (i == FAKEJACK_MAX_PORTS || !(port = calloc(1, sizeof(*port))))
+        return NULL;
+    snprintf(port->name, sizeof(port->name), "%s:%s", client->name, port_name);
+    port->flags = flags;
+    fake_ports[i] = port;
+    return port;
+}
+
+EXPORT int jack_port_unregister(jack_client_t* client, jack_port_t* port)
+{
+    int i;
+
+    for (i = 0; i < FAKEJACK_MAX_PORTS; i++)
+    {
+        if (fake_ports[i] == port)
+        {
+            fake_ports[i] = NULL;
+            free(port);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+EXPORT void* jack_port_get_buffer(jack_port_t* port, jack_nframes_t nframes)
+{
+    return port->buffer;
+}
+
+EXPORT const char* jack_port_name(const jack_port_t* port)
+{
+    return port->name;
+}
+
+EXPORT const char* jack_port_type(const jack_port_t* port)
+{
+    return JACK_DEFAULT_AUDIO_TYPE;
+}
+
+EXPORT int jack_port_is_mine(const jack_client_t* client, const jack_port_t* port)
+{
+    return 1;
+}
+
+EXPORT int jack_port_connected(const jack_port_t* port)
+{
+    return 1;
+}
+
+EXPORT jack_port_t* jack_port_by_name(jack_client_t* client, const char* port_name)
+{
+    int i;
+
+    for (i = 0; i < FAKEJACK_MAX_PORTS; i++)
+        if (fake_ports[i] && !strcmp(fake_ports[i]->name, port_name))
+            return fake_ports[i];
+    return NULL;
+}
+
+EXPORT void jack_port_get_latency_range(jack_port_t* port, jack_latency_callback_mode_t mode, jack_latency_range_t* range)
+{
+    range->min = range->max = 0;
+}
+
+EXPORT void jack_port_set_latency_range(jack_port_t* port, jack_latency_callback_mode_t mode, jack_latency_range_t* range)
+{
+}
+
+/* there is no hardware to connect to */
+EXPORT const char** jack_get_ports(jack_client_t* client, const char* port_name_pattern, const char* type_name_pattern,
+                                   unsigned long flags)
+{
+    return NULL;
+}
+
+EXPORT int jack_connect(jack_client_t* client, const char* source_port, const char* destination_port)
+{
+    return 0;
+}
+
+EXPORT void jack_free(void* ptr)
+{
+    free(ptr);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// time and transport
+
+EXPORT jack_time_t jack_get_time(void)
+{
+    return monotonic_nsecs() / 1000;
+}
+
+EXPORT jack_nframes_t jack_last_frame_time(const jack_client_t* client)
+{
+    return client->frames;
+}
+
+EXPORT jack_time_t jack_frames_to_time(const jack_client_t* client, jack_nframes_t frames)
+{
+    return client->cycle_usecs;
+}
+
+EXPORT int jack_get_cycle_times(const jack_client_t* client, jack_nframes_t* current_frames, jack_time_t* current_usecs,
+                                jack_time_t* next_usecs, float* period_usecs)
+{
+    *current_frames = client->frames;
+    *current_usecs = client->cycle_usecs;
+    *period_usecs = fake_buffer_size * 1000000.0f / fake_sample_rate;
+    *next_usecs = client->cycle_usecs + (jack_time_t) *period_usecs;
+    return 0;
+}
+
+EXPORT jack_transport_state_t jack_transport_query(const jack_client_t* client, jack_position_t* pos)
+{
+    if (pos)
+    {
+        memset(pos, 0, sizeof(*pos));
+        pos->frame_rate = fake_sample_rate;
+    }
+    return JackTransportStopped;
+}
@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2026 WineASIO contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/* Stand-in libjack.so.0 for benchmarking, see fakejack.c
+ * Besides the JACK API subset the driver uses it exports these, for the benchmark host to dlsym() */
+
+typedef struct FakeJackStats
+{
+    uint64_t    cycles;
+    uint64_t    nsecs;
+    int         perf;           /* the counters below are only valid if perf_event was available */
+    uint64_t    cpu_cycles;
+    uint64_t    instructions;
+    uint64_t    cache_misses;
+} FakeJackStats;
+
+/* Sets the period and sample rate reported to clients opened afterwards */
+typedef void (*fakejack_configure_func)(uint32_t buffer_size, uint32_t sample_rate);
+
+/* Runs the process callback of the active client cycles times on the calling thread, as fast as possible */
+typedef int (*fakejack_run_func)(uint64_t cycles, FakeJackStats *stats);
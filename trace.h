@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2026 WineASIO contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/* Flight recorder, the driver keeps the last WINEASIO_TRACE_EVENTS events in memory and writes them out
+ * on the trace signal (see README.md) or when the host calls Future(WINEASIO_FUTURE_DUMP_TRACE, path).
+ *
+ * A dump is a WineASIOTraceHeader followed by events, oldest first, until the end of the file.
+ * The layout is the same for 32 and 64 bit builds. */
+
+#define WINEASIO_TRACE_EVENTS       16384   /* power of two */
+#define WINEASIO_TRACE_VERSION      1
+#define WINEASIO_FUTURE_DUMP_TRACE  0x57415452  /* Future() selector, opt is the file path or NULL */
+
+enum {
+    WINEASIO_TRACE_CYCLE = 1,       /* one host callback */
+    WINEASIO_TRACE_INIT,
+    WINEASIO_TRACE_CREATE_BUFFERS,  /* frames is the host buffer size */
+    WINEASIO_TRACE_START,
+    WINEASIO_TRACE_STOP,
+    WINEASIO_TRACE_DISPOSE_BUFFERS,
+    WINEASIO_TRACE_BUFFER_SIZE,     /* frames is the new JACK period */
+    WINEASIO_TRACE_SAMPLE_RATE      /* frames is the new sample rate */
+};
+
+typedef struct WineASIOTraceHeader
+{
+    char        magic[8];           /* "WASIOTRC" */
+    uint32_t    version;
+    uint32_t    event_size;
+} WineASIOTraceHeader;
+
+typedef struct WineASIOTraceEvent
+{
+    uint32_t    sequence;           /* position in the recording, starting at 1 */
+    uint16_t    type;
+    uint8_t     buffer_index;       /* host buffer half, cycles only */
+    uint8_t     transport_state;    /* jack_transport_state_t, cycles only */
+    uint32_t    frames;
+    uint32_t    channels;           /* active host inputs and outputs */
+    uint64_t    start_usecs;        /* JACK time before and after the host callback, */
+    uint64_t    end_usecs;          /* or both when the event happened */
+} WineASIOTraceEvent;